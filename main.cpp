@@ -6,15 +6,36 @@
 #include <array>
 #include <cmath>
 #include <algorithm>
+#include <queue>
+#include <functional>
+#include <string>
+#include <cstdio>
+#include <cstring>
+
+// SSE2 is used to expand the monochrome bitplane when the compiler targets it
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HAVE_SSE2 1
+#endif
+
+// Hardware performance counters come from perf_event_open on Linux
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define HAVE_PERF_EVENTS 1
+#endif
 
 // IMPORTANT: This is needed for Windows to properly link SDL2
 #ifdef _WIN32
 #include <SDL2/SDL_main.h>
 #endif
 
-// Constants
-const int SCREEN_WIDTH = 800;
-const int SCREEN_HEIGHT = 600;
+// Render resolution: the framebuffer size, which is the window size times the render scale
+int SCREEN_WIDTH = 800;
+int SCREEN_HEIGHT = 600;
+int windowWidth = 800;
+int windowHeight = 600;
 
 // Simple Vec3 structure (no GLM dependency)
 struct Vec3 {
@@ -150,6 +171,17 @@ struct Color {
     }
 };
 
+// Typed view over ARGB8888 pixel memory (stride is in pixels)
+struct PixelView {
+    uint32_t* pixels;
+    int width, height;
+    int stride;
+    
+    uint32_t* row(int y) const {
+        return pixels + static_cast<size_t>(y) * stride;
+    }
+};
+
 // Face structure
 struct Face {
     std::vector<std::array<int, 3>> vertexIndices;
@@ -159,7 +191,10 @@ struct Face {
 SDL_Window* window = nullptr;
 SDL_Renderer* renderer = nullptr;
 Color currentColor;
-std::vector<Color> framebuffer;
+uint32_t currentPixel = 0xFF000000;    // currentColor packed as ARGB8888
+const uint32_t BACKGROUND_PIXEL = 0xFF000000;  // Opaque black
+std::vector<uint32_t> framebuffer;     // Packed ARGB8888, same layout as the streaming texture
+PixelView drawTarget = {nullptr, 0, 0, 0};  // Where pixel() and clear() write
 
 // Camera parameters
 float cameraAngleY = 0.0f;
@@ -167,33 +202,665 @@ float cameraAngleX = 0.0f;
 float cameraDistance = 5.0f;
 bool autoRotate = false;
 
+// Camera snapshot handed from input handling to whoever renders the frame
+struct CameraState {
+    float angleX, angleY, distance;
+    Uint64 inputCounter;  // Performance counter when the input behind this view was handled
+};
+
+CameraState captureCamera() {
+    CameraState state = {cameraAngleX, cameraAngleY, cameraDistance, 0};
+    return state;
+}
+
+void applyCamera(const CameraState& state) {
+    cameraAngleX = state.angleX;
+    cameraAngleY = state.angleY;
+    cameraDistance = state.distance;
+}
+
+// Screen rectangle of touched pixels (inclusive bounds, empty when x0 > x1)
+struct DirtyRect {
+    int x0, y0, x1, y1;
+    
+    DirtyRect() : x0(1), y0(1), x1(0), y1(0) {}
+    DirtyRect(int ax, int ay, int bx, int by) : x0(ax), y0(ay), x1(bx), y1(by) {}
+    
+    bool empty() const {
+        return x0 > x1 || y0 > y1;
+    }
+    
+    int width() const {
+        return empty() ? 0 : x1 - x0 + 1;
+    }
+    
+    int height() const {
+        return empty() ? 0 : y1 - y0 + 1;
+    }
+    
+    size_t area() const {
+        return static_cast<size_t>(width()) * height();
+    }
+    
+    DirtyRect unite(const DirtyRect& other) const {
+        if (empty()) return other;
+        if (other.empty()) return *this;
+        return DirtyRect(std::min(x0, other.x0), std::min(y0, other.y0), std::max(x1, other.x1), std::max(y1, other.y1));
+    }
+};
+
+// Dirty rectangle tracking: only the pixels drawn last frame need clearing,
+// and only those plus this frame's need uploading
+bool dirtyRectsEnabled = false;
+bool dirtyHistoryValid = false;  // False forces the next frame to clear and upload everything
+DirtyRect frameDirty;            // Drawn since the last clear
+DirtyRect previousDirty;         // Drawn in the last presented frame
+size_t bytesCleared = 0;         // Per-frame statistics
+size_t bytesUploaded = 0;
+size_t trianglesDrawn = 0;       // Running totals on whichever thread renders
+size_t pixelsDrawn = 0;
+size_t framebufferAllocations = 0;  // Times the framebuffer had to grow
+
+// Grow this frame's dirty rectangle by a box, clamped to the screen
+void markDirty(int ax, int ay, int bx, int by) {
+    DirtyRect box(std::max(0, std::min(ax, bx)), std::max(0, std::min(ay, by)),
+                  std::min(SCREEN_WIDTH - 1, std::max(ax, bx)), std::min(SCREEN_HEIGHT - 1, std::max(ay, by)));
+    if (!box.empty()) frameDirty = frameDirty.unite(box);
+}
+
+// Chrome trace-event recording. Each thread appends zones to its own ring without
+// locks; the rings are written out as trace JSON for chrome://tracing or Perfetto.
+bool traceEnabled = false;
+std::string tracePath;
+Uint64 traceStartTicks = 0;
+
+struct TraceEvent {
+    const char* name;  // String literal, never freed
+    Uint64 start;
+    Uint64 end;
+};
+
+// Events of one thread, written only by that thread. The oldest events are
+// overwritten once the ring is full.
+struct TraceRing {
+    static const int CAPACITY = 1 << 16;
+    
+    TraceEvent events[CAPACITY];
+    SDL_atomic_t written;  // Events ever recorded
+    const char* threadName;
+};
+
+const int MAX_TRACE_THREADS = 8;
+TraceRing* traceRings[MAX_TRACE_THREADS];
+int traceRingCount = 0;
+SDL_SpinLock traceRingLock = 0;
+thread_local TraceRing* threadTraceRing = nullptr;
+
+// Ring for a thread name. Threads that are restarted, like the render thread,
+// keep appending to the ring of their previous run.
+TraceRing* traceRingFor(const char* threadName) {
+    TraceRing* ring = nullptr;
+    SDL_AtomicLock(&traceRingLock);
+    for (int i = 0; i < traceRingCount && !ring; i++) {
+        if (strcmp(traceRings[i]->threadName, threadName) == 0) ring = traceRings[i];
+    }
+    if (!ring && traceRingCount < MAX_TRACE_THREADS) {
+        ring = new TraceRing();
+        SDL_AtomicSet(&ring->written, 0);
+        ring->threadName = threadName;
+        traceRings[traceRingCount++] = ring;
+    }
+    SDL_AtomicUnlock(&traceRingLock);
+    return ring;
+}
+
+// Record the current thread's zones under a name; threads that never call this are "main"
+void setTraceThread(const char* threadName) {
+    if (traceEnabled) threadTraceRing = traceRingFor(threadName);
+}
+
+void traceEvent(const char* name, Uint64 start, Uint64 end) {
+    if (!threadTraceRing) threadTraceRing = traceRingFor("main");
+    if (!threadTraceRing) return;
+    TraceRing& ring = *threadTraceRing;
+    int count = SDL_AtomicGet(&ring.written);
+    TraceEvent& event = ring.events[count & (TraceRing::CAPACITY - 1)];
+    event.name = name;
+    event.start = start;
+    event.end = end;
+    SDL_AtomicSet(&ring.written, count + 1);
+}
+
+// Records a trace zone while in scope; a null name records nothing
+struct TraceZone {
+    const char* name;
+    Uint64 start;
+    
+    explicit TraceZone(const char* zoneName) : name(traceEnabled ? zoneName : nullptr), start(0) {
+        if (name) start = SDL_GetPerformanceCounter();
+    }
+    
+    ~TraceZone() {
+        if (name) traceEvent(name, start, SDL_GetPerformanceCounter());
+    }
+};
+
+// Write every ring as Chrome trace JSON. Call while no other thread is recording.
+bool writeTrace(const std::string& path) {
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "Could not write trace " << path << std::endl;
+        return false;
+    }
+    
+    double ticksToUs = 1000000.0 / SDL_GetPerformanceFrequency();
+    size_t events = 0;
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    SDL_AtomicLock(&traceRingLock);
+    for (int t = 0; t < traceRingCount; t++) {
+        const TraceRing& ring = *traceRings[t];
+        out << (t ? ",\n" : "\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << t + 1
+            << ",\"args\":{\"name\":\"" << ring.threadName << "\"}}";
+        
+        int written = SDL_AtomicGet(const_cast<SDL_atomic_t*>(&ring.written));
+        for (int i = std::max(0, written - TraceRing::CAPACITY); i < written; i++) {
+            const TraceEvent& event = ring.events[i & (TraceRing::CAPACITY - 1)];
+            char row[160];
+            snprintf(row, sizeof(row), ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                     event.name, t + 1, (event.start - traceStartTicks) * ticksToUs, (event.end - event.start) * ticksToUs);
+            out << row;
+            events++;
+        }
+    }
+    SDL_AtomicUnlock(&traceRingLock);
+    out << "\n]}\n";
+    std::cout << "Wrote " << events << " trace events to " << path << std::endl;
+    return true;
+}
+
+// Frame stages timed by the profiler. Render stages run wherever renderScene()
+// runs; present stages always run on the main thread.
+enum ProfileStage {
+    STAGE_CLEAR,
+    STAGE_MATRICES,
+    STAGE_TRANSFORM,
+    STAGE_FACES,
+    STAGE_RASTER,
+    STAGE_CONVERT,
+    STAGE_UPLOAD,
+    STAGE_PRESENT,
+    STAGE_COUNT
+};
+const int FIRST_PRESENT_STAGE = STAGE_CONVERT;
+const char* const STAGE_NAMES[STAGE_COUNT] = {"clear", "matrices", "transform", "faces", "raster", "convert", "upload", "present"};
+
+SDL_atomic_t profilerEnabled;  // Toggled by the main thread, read once per frame by each stage group
+bool stageProfiling[2];        // That frame's snapshot for the render and the present stages
+Uint64 stageTicks[STAGE_COUNT];  // This frame so far, excluding nested stages
+
+// Times a stage while in scope. A nested timer pauses its parent, so every stage
+// reports exclusive time (raster inside the face loop, conversion inside an upload).
+struct StageTimer {
+    static StageTimer* active[2];  // Innermost timer of the render and the present stages
+    
+    ProfileStage stage;
+    StageTimer* parent;
+    Uint64 start;
+    bool timing;
+    TraceZone zone;  // Rasterization is traced by the face loop around it, not per line
+    
+    explicit StageTimer(ProfileStage s) : stage(s), parent(nullptr), start(0), timing(stageProfiling[s >= FIRST_PRESENT_STAGE]),
+                                          zone(s == STAGE_RASTER ? nullptr : STAGE_NAMES[s]) {
+        if (!timing) return;
+        start = SDL_GetPerformanceCounter();
+        StageTimer*& top = active[stage >= FIRST_PRESENT_STAGE];
+        parent = top;
+        if (parent) stageTicks[parent->stage] += start - parent->start;
+        top = this;
+    }
+    
+    ~StageTimer() {
+        if (!timing) return;
+        Uint64 now = SDL_GetPerformanceCounter();
+        stageTicks[stage] += now - start;
+        active[stage >= FIRST_PRESENT_STAGE] = parent;
+        if (parent) parent->start = now;
+    }
+};
+StageTimer* StageTimer::active[2] = {nullptr, nullptr};
+
+// Hardware counters read around the transform loop, the face loop (which is mostly
+// rasterization) and the texture upload. Each thread counts its own work.
+enum PerfCounter {
+    COUNTER_CYCLES,
+    COUNTER_INSTRUCTIONS,
+    COUNTER_L1D_MISSES,
+    COUNTER_LLC_MISSES,
+    COUNTER_BRANCH_MISSES,
+    COUNTER_COUNT
+};
+const char* const COUNTER_NAMES[COUNTER_COUNT] = {"cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses"};
+const ProfileStage COUNTED_STAGES[3] = {STAGE_TRANSFORM, STAGE_RASTER, STAGE_UPLOAD};
+
+bool perfCountersEnabled = false;
+uint64_t stageCounters[STAGE_COUNT][COUNTER_COUNT];  // This frame so far, only counted stages
+
+// One group read: running totals plus how long the group was enabled and how long it
+// actually had the PMU. Less running than enabled time means the kernel multiplexed it.
+struct CounterSample {
+    uint64_t values[COUNTER_COUNT];
+    uint64_t enabled, running;
+};
+
+// One thread's counters, opened as a group so they are scheduled together
+struct PerfGroup {
+    int fds[COUNTER_COUNT];
+    int position[COUNTER_COUNT];  // Index in a group read, -1 when the counter could not be opened
+    int members;
+    
+    PerfGroup() : members(0) {
+        for (int c = 0; c < COUNTER_COUNT; c++) {
+            fds[c] = -1;
+            position[c] = -1;
+        }
+    }
+    
+    // Open whatever counters this CPU and kernel allow; false when none are
+    bool open() {
+#ifdef HAVE_PERF_EVENTS
+        const uint32_t types[COUNTER_COUNT] = {PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE};
+        const uint64_t readMiss = (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        const uint64_t configs[COUNTER_COUNT] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_L1D | readMiss,
+                                                 PERF_COUNT_HW_CACHE_LL | readMiss, PERF_COUNT_HW_BRANCH_MISSES};
+        int leader = -1;
+        for (int c = 0; c < COUNTER_COUNT; c++) {
+            perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = types[c];
+            attr.config = configs[c];
+            attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            attr.exclude_kernel = 1;  // User-space only, allowed at the default perf_event_paranoid
+            attr.exclude_hv = 1;
+            fds[c] = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, leader, 0));
+            if (fds[c] < 0) continue;
+            if (leader < 0) leader = fds[c];
+            position[c] = members++;
+        }
+#endif
+        return members > 0;
+    }
+    
+    void close() {
+#ifdef HAVE_PERF_EVENTS
+        for (int c = 0; c < COUNTER_COUNT; c++) {
+            if (fds[c] >= 0) ::close(fds[c]);
+        }
+#endif
+        *this = PerfGroup();
+    }
+    
+    bool read(CounterSample& sample) const {
+#ifdef HAVE_PERF_EVENTS
+        // Layout: member count, time enabled, time running, then one value per member
+        uint64_t buffer[3 + COUNTER_COUNT];
+        int leader = -1;
+        for (int c = 0; c < COUNTER_COUNT && leader < 0; c++) leader = fds[c];
+        if (leader < 0 || ::read(leader, buffer, sizeof(buffer)) < static_cast<ssize_t>((3 + members) * sizeof(uint64_t))) return false;
+        sample.enabled = buffer[1];
+        sample.running = buffer[2];
+        for (int c = 0; c < COUNTER_COUNT; c++) sample.values[c] = position[c] >= 0 ? buffer[3 + position[c]] : 0;
+        return true;
+#else
+        (void)sample;
+        return false;
+#endif
+    }
+};
+
+thread_local PerfGroup threadCounters;
+thread_local bool threadCountersTried = false;
+thread_local bool threadCountersStarved = false;  // Already warned that the group was not scheduled
+
+bool readThreadCounters(CounterSample& sample) {
+    if (!threadCountersTried) {
+        threadCountersTried = true;
+        threadCounters.open();
+    }
+    return threadCounters.read(sample);
+}
+
+// Threads that end close their counters so a restarted thread opens fresh ones
+void closeThreadCounters() {
+    threadCounters.close();
+    threadCountersTried = false;
+}
+
+// Adds the counters of a stage while in scope, or until stop()
+struct CounterScope {
+    ProfileStage stage;
+    bool counting;
+    CounterSample start;
+    
+    explicit CounterScope(ProfileStage s) : stage(s), counting(perfCountersEnabled && stageProfiling[s >= FIRST_PRESENT_STAGE]) {
+        if (counting) counting = readThreadCounters(start);
+    }
+    
+    ~CounterScope() {
+        stop();
+    }
+    
+    void stop() {
+        CounterSample end;
+        if (counting && readThreadCounters(end)) {
+            uint64_t enabled = end.enabled - start.enabled;
+            uint64_t running = end.running - start.running;
+            if (running > 0) {
+                // Extrapolate a multiplexed group to the whole scope
+                double scale = running < enabled ? static_cast<double>(enabled) / running : 1.0;
+                for (int c = 0; c < COUNTER_COUNT; c++) {
+                    stageCounters[stage][c] += static_cast<uint64_t>((end.values[c] - start.values[c]) * scale + 0.5);
+                }
+            } else if (enabled > 0 && !threadCountersStarved) {
+                threadCountersStarved = true;
+                std::cerr << "Hardware counters were not scheduled during a " << STAGE_NAMES[stage]
+                          << " stage (other perf users?); such stages are left out of the counts" << std::endl;
+            }
+        }
+        counting = false;
+    }
+};
+
+// Monochrome wireframe mode: lines set bits in a 1 bit per pixel plane that is
+// expanded to ARGB8888 with currentColor only when the frame is presented
+bool monochromeEnabled = false;
+bool monochromeFrameValid = false;  // Bitplane holds a complete frame
+std::vector<uint64_t> bitplane;
+int bitplaneWords = 0;              // 64-bit words per row
+
+// Expand the bitplane into ARGB8888 pixels
+void expandBitplane(const PixelView& dst, uint32_t foreground, uint32_t background) {
+    StageTimer timer(STAGE_CONVERT);
+#ifdef HAVE_SSE2
+    const __m128i bitsLow = _mm_set_epi32(8, 4, 2, 1);
+    const __m128i bitsHigh = _mm_set_epi32(128, 64, 32, 16);
+    const __m128i bg = _mm_set1_epi32(static_cast<int>(background));
+    const __m128i diff = _mm_set1_epi32(static_cast<int>(foreground ^ background));
+#endif
+    
+    for (int y = 0; y < dst.height; y++) {
+        const uint64_t* bits = &bitplane[static_cast<size_t>(y) * bitplaneWords];
+        uint32_t* out = dst.row(y);
+        int x = 0;
+        
+#ifdef HAVE_SSE2
+        // Eight pixels per byte: select foreground where the lane's bit is set
+        for (; x + 8 <= dst.width; x += 8) {
+            int byte = static_cast<int>((bits[x >> 6] >> (x & 63)) & 0xFF);
+            __m128i v = _mm_set1_epi32(byte);
+            __m128i maskLow = _mm_cmpeq_epi32(_mm_and_si128(v, bitsLow), bitsLow);
+            __m128i maskHigh = _mm_cmpeq_epi32(_mm_and_si128(v, bitsHigh), bitsHigh);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x), _mm_xor_si128(bg, _mm_and_si128(maskLow, diff)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x + 4), _mm_xor_si128(bg, _mm_and_si128(maskHigh, diff)));
+        }
+#endif
+        for (; x < dst.width; x++) {
+            out[x] = ((bits[x >> 6] >> (x & 63)) & 1) ? foreground : background;
+        }
+    }
+}
+
+// Copy pixels into dst and reset the source to the background in the same pass.
+// The copy uses non-temporal stores so the upload does not evict the framebuffer,
+// which the next frame rasterizes into again.
+void copyAndClear(const PixelView& dst, uint32_t* src, int srcStride) {
+    StageTimer timer(STAGE_UPLOAD);
+#ifdef HAVE_SSE2
+    const __m128i bg = _mm_set1_epi32(static_cast<int>(BACKGROUND_PIXEL));
+#endif
+    for (int y = 0; y < dst.height; y++) {
+        uint32_t* in = src + static_cast<size_t>(y) * srcStride;
+        uint32_t* out = dst.row(y);
+        int x = 0;
+        
+#ifdef HAVE_SSE2
+        // Streaming stores need 16-byte aligned destinations
+        for (; x < dst.width && (reinterpret_cast<uintptr_t>(out + x) & 15) != 0; x++) {
+            out[x] = in[x];
+            in[x] = BACKGROUND_PIXEL;
+        }
+        for (; x + 4 <= dst.width; x += 4) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + x));
+            _mm_stream_si128(reinterpret_cast<__m128i*>(out + x), v);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(in + x), bg);
+        }
+#endif
+        for (; x < dst.width; x++) {
+            out[x] = in[x];
+            in[x] = BACKGROUND_PIXEL;
+        }
+    }
+#ifdef HAVE_SSE2
+    _mm_sfence();
+#endif
+}
+
+// Fused clear: the upload leaves the framebuffer cleared so clear() can skip it
+bool fusedClearEnabled = true;
+bool framebufferPreCleared = false;
+
+// Tiled framebuffer layout: 8x8 tiles stored one after another in row-major tile
+// order, pixels inside a tile in Morton order so each 4x4 block shares a cache line
+const int TILE_SHIFT = 3;
+const int TILE_SIZE = 1 << TILE_SHIFT;
+const int TILE_MASK = TILE_SIZE - 1;
+const int TILE_PIXELS = TILE_SIZE * TILE_SIZE;
+bool tiledEnabled = false;
+int tilesPerRow = 0;
+uint8_t mortonOffset[TILE_SIZE][TILE_SIZE];  // [y][x] -> index inside a tile
+std::vector<uint32_t> detileScratch;          // Linear copy for surfaces that need converting
+
+// Index of a screen pixel in the tiled framebuffer
+inline size_t tiledOffset(int x, int y) {
+    return ((static_cast<size_t>(y >> TILE_SHIFT) * tilesPerRow + (x >> TILE_SHIFT)) << (2 * TILE_SHIFT)) +
+           mortonOffset[y & TILE_MASK][x & TILE_MASK];
+}
+
+// Copy a screen rectangle of the tiled framebuffer into linear pixels whose first
+// row and column are rect.y0 and rect.x0, optionally clearing what was read
+void detile(const PixelView& dst, const DirtyRect& rect, bool clearSource) {
+    StageTimer timer(STAGE_CONVERT);
+    for (int y = rect.y0; y <= rect.y1; y++) {
+        uint32_t* out = dst.row(y - rect.y0) - rect.x0;
+        uint32_t* tileRow = &framebuffer[static_cast<size_t>(y >> TILE_SHIFT) * tilesPerRow * TILE_PIXELS];
+        const uint8_t* offsets = mortonOffset[y & TILE_MASK];
+        
+        if (clearSource) {
+            for (int x = rect.x0; x <= rect.x1; x++) {
+                uint32_t* src = tileRow + ((x >> TILE_SHIFT) << (2 * TILE_SHIFT)) + offsets[x & TILE_MASK];
+                out[x] = *src;
+                *src = BACKGROUND_PIXEL;
+            }
+        } else {
+            for (int x = rect.x0; x <= rect.x1; x++) {
+                out[x] = tileRow[((x >> TILE_SHIFT) << (2 * TILE_SHIFT)) + offsets[x & TILE_MASK]];
+            }
+        }
+    }
+}
+
+// Clear every tile a screen rectangle touches, one contiguous run per tile row
+void clearTiles(const DirtyRect& rect) {
+    bytesCleared = 0;
+    if (rect.empty()) return;
+    for (int ty = rect.y0 >> TILE_SHIFT; ty <= rect.y1 >> TILE_SHIFT; ty++) {
+        size_t first = (static_cast<size_t>(ty) * tilesPerRow + (rect.x0 >> TILE_SHIFT)) * TILE_PIXELS;
+        size_t last = (static_cast<size_t>(ty) * tilesPerRow + (rect.x1 >> TILE_SHIFT) + 1) * TILE_PIXELS;
+        std::fill(framebuffer.begin() + first, framebuffer.begin() + last, BACKGROUND_PIXEL);
+        bytesCleared += (last - first) * sizeof(uint32_t);
+    }
+}
+
 // Initialize framebuffer
 void initFramebuffer() {
-    framebuffer.resize(SCREEN_WIDTH * SCREEN_HEIGHT);
+    // Room for whole tiles so the tiled layout fits the same allocation
+    tilesPerRow = (SCREEN_WIDTH + TILE_SIZE - 1) / TILE_SIZE;
+    int tileRows = (SCREEN_HEIGHT + TILE_SIZE - 1) / TILE_SIZE;
+    size_t needed = std::max(static_cast<size_t>(SCREEN_WIDTH) * SCREEN_HEIGHT,
+                             static_cast<size_t>(tilesPerRow) * tileRows * TILE_PIXELS);
+    // Only grow: shrinking the window or render scale reuses the allocation
+    if (needed > framebuffer.size()) {
+        framebuffer.resize(needed, BACKGROUND_PIXEL);
+        framebufferAllocations++;
+    }
+    for (int y = 0; y < TILE_SIZE; y++) {
+        for (int x = 0; x < TILE_SIZE; x++) {
+            int offset = 0;
+            for (int bit = 0; (1 << bit) < TILE_SIZE; bit++) {
+                offset |= ((x >> bit) & 1) << (2 * bit);
+                offset |= ((y >> bit) & 1) << (2 * bit + 1);
+            }
+            mortonOffset[y][x] = static_cast<uint8_t>(offset);
+        }
+    }
+    
+    drawTarget.pixels = framebuffer.data();
+    drawTarget.width = SCREEN_WIDTH;
+    drawTarget.height = SCREEN_HEIGHT;
+    drawTarget.stride = SCREEN_WIDTH;
+    
+    bitplaneWords = (SCREEN_WIDTH + 63) / 64;
+    size_t words = static_cast<size_t>(bitplaneWords) * SCREEN_HEIGHT;
+    if (words > bitplane.size()) bitplane.resize(words);
+}
+
+// Dynamic resolution: the render scale drops when frames run over the budget and
+// climbs back when there is headroom; presenting stretches the frame to the window
+bool dynamicResolutionEnabled = false;
+float renderScale = 1.0f;
+float frameBudgetMs = 16.7f;
+const float MIN_RENDER_SCALE = 0.25f;
+float smoothedFrameMs = 0.0f;
+int framesAtScale = 0;  // Frames averaged since the last scale change
+
+// Size the framebuffer for the current window size and render scale
+void setRenderResolution() {
+    int width = std::max(1, static_cast<int>(windowWidth * renderScale + 0.5f));
+    int height = std::max(1, static_cast<int>(windowHeight * renderScale + 0.5f));
+    if (width == SCREEN_WIDTH && height == SCREEN_HEIGHT) return;
+    
+    SCREEN_WIDTH = width;
+    SCREEN_HEIGHT = height;
+    initFramebuffer();
+    
+    // Nothing drawn at the old size carries over
+    dirtyHistoryValid = false;
+    frameDirty = DirtyRect();
+    previousDirty = DirtyRect();
+    monochromeFrameValid = false;
+    framebufferPreCleared = false;
+}
+
+// Feed one frame time to the controller; true when the render scale changed
+bool updateRenderScale(double frameMs) {
+    if (!dynamicResolutionEnabled) return false;
+    smoothedFrameMs = (framesAtScale == 0) ? static_cast<float>(frameMs) : smoothedFrameMs * 0.8f + static_cast<float>(frameMs) * 0.2f;
+    framesAtScale++;
+    
+    // Scales move in sixteenths so small jitter leaves the resolution alone
+    float target = renderScale;
+    if (smoothedFrameMs > frameBudgetMs && framesAtScale >= 2) {
+        // Treat cost as proportional to pixel count, so each side shrinks by the square root
+        target = std::floor(renderScale * std::max(0.7f, std::sqrt(frameBudgetMs / smoothedFrameMs)) * 16.0f) / 16.0f;
+    } else if (smoothedFrameMs < frameBudgetMs * 0.6f && framesAtScale >= 10) {
+        // Climb one step at a time so a cheap frame does not bounce straight back over budget
+        target = renderScale + 1.0f / 16.0f;
+    }
+    target = std::min(1.0f, std::max(MIN_RENDER_SCALE, target));
+    if (target == renderScale) return false;
+    
+    renderScale = target;
+    framesAtScale = 0;
+    return true;
+}
+
+// Stretch ARGB8888 pixels at render resolution over a window surface of another size
+void blitScaledToSurface(uint32_t* pixels, int stride, SDL_Surface* surface) {
+    StageTimer timer(STAGE_CONVERT);
+    SDL_Surface* source = SDL_CreateRGBSurfaceWithFormatFrom(pixels, SCREEN_WIDTH, SCREEN_HEIGHT, 32,
+        stride * static_cast<int>(sizeof(uint32_t)), SDL_PIXELFORMAT_ARGB8888);
+    if (source == nullptr) return;
+    SDL_BlitScaled(source, nullptr, surface, nullptr);
+    SDL_FreeSurface(source);
 }
 
 // Clear framebuffer with background color
 void clear() {
-    std::fill(framebuffer.begin(), framebuffer.end(), Color(0, 0, 0));  // Black background
+    StageTimer timer(STAGE_CLEAR);
+    if (monochromeEnabled) {
+        std::fill(bitplane.begin(), bitplane.end(), 0);
+        bytesCleared = bitplane.size() * sizeof(uint64_t);
+        frameDirty = DirtyRect();
+        monochromeFrameValid = true;
+        return;
+    }
+    if (framebufferPreCleared && drawTarget.pixels == framebuffer.data()) {
+        // The last upload already wrote the background back
+        framebufferPreCleared = false;
+        bytesCleared = 0;
+    } else if (tiledEnabled) {
+        if (dirtyRectsEnabled && dirtyHistoryValid) {
+            clearTiles(previousDirty.unite(frameDirty));
+        } else {
+            std::fill(framebuffer.begin(), framebuffer.end(), BACKGROUND_PIXEL);
+            bytesCleared = framebuffer.size() * sizeof(uint32_t);
+        }
+    } else if (dirtyRectsEnabled && dirtyHistoryValid) {
+        // Everything outside these rectangles is still background
+        DirtyRect rect = previousDirty.unite(frameDirty);
+        for (int y = rect.y0; y <= rect.y1; y++) {
+            std::fill(drawTarget.row(y) + rect.x0, drawTarget.row(y) + rect.x1 + 1, BACKGROUND_PIXEL);
+        }
+        bytesCleared = rect.area() * sizeof(uint32_t);
+    } else if (drawTarget.stride == drawTarget.width) {
+        std::fill(drawTarget.pixels, drawTarget.pixels + drawTarget.width * drawTarget.height, BACKGROUND_PIXEL);
+        bytesCleared = static_cast<size_t>(drawTarget.width) * drawTarget.height * sizeof(uint32_t);
+    } else {
+        for (int y = 0; y < drawTarget.height; y++) {
+            std::fill(drawTarget.row(y), drawTarget.row(y) + drawTarget.width, BACKGROUND_PIXEL);
+        }
+        bytesCleared = static_cast<size_t>(drawTarget.width) * drawTarget.height * sizeof(uint32_t);
+    }
+    framebufferPreCleared = false;
+    frameDirty = DirtyRect();
 }
 
 // Set pixel in framebuffer
 void pixel(int x, int y) {
     // Check bounds
     if (x >= 0 && x < SCREEN_WIDTH && y >= 0 && y < SCREEN_HEIGHT) {
-        framebuffer[y * SCREEN_WIDTH + x] = currentColor;
+        if (monochromeEnabled) {
+            bitplane[static_cast<size_t>(y) * bitplaneWords + (x >> 6)] |= uint64_t(1) << (x & 63);
+        } else if (tiledEnabled) {
+            framebuffer[tiledOffset(x, y)] = currentPixel;
+        } else {
+            drawTarget.row(y)[x] = currentPixel;
+        }
     }
 }
 
 // Bresenham's line algorithm
 void line(Vec3 start, Vec3 end) {
+    StageTimer timer(STAGE_RASTER);
     int x1 = static_cast<int>(std::round(start.x));
     int y1 = static_cast<int>(std::round(start.y));
     int x2 = static_cast<int>(std::round(end.x));
     int y2 = static_cast<int>(std::round(end.y));
+    markDirty(x1, y1, x2, y2);
     
     int dx = std::abs(x2 - x1);
     int dy = std::abs(y2 - y1);
+    pixelsDrawn += std::max(dx, dy) + 1;
     int sx = (x1 < x2) ? 1 : -1;
     int sy = (y1 < y2) ? 1 : -1;
     int err = dx - dy;
@@ -222,14 +889,8 @@ void triangle(const Vec3& A, const Vec3& B, const Vec3& C) {
     line(C, A);
 }
 
-// Load OBJ file
-bool loadOBJ(const std::string& path, std::vector<Vec3>& out_vertices, std::vector<Face>& out_faces) {
-    std::ifstream file(path);
-    if (!file.is_open()) {
-        std::cerr << "Failed to open OBJ file: " << path << std::endl;
-        return false;
-    }
-    
+// Parse OBJ text from any stream
+void parseOBJ(std::istream& file, std::vector<Vec3>& out_vertices, std::vector<Face>& out_faces) {
     std::string line;
     while (std::getline(file, line)) {
         std::istringstream iss(line);
@@ -270,174 +931,4231 @@ bool loadOBJ(const std::string& path, std::vector<Vec3>& out_vertices, std::vect
         }
     }
     
-    file.close();
     std::cout << "Loaded " << out_vertices.size() << " vertices and " << out_faces.size() << " faces" << std::endl;
+}
+
+// Load OBJ file
+bool loadOBJ(const std::string& path, std::vector<Vec3>& out_vertices, std::vector<Face>& out_faces) {
+    TraceZone zone("loadOBJ");
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open OBJ file: " << path << std::endl;
+        return false;
+    }
+    parseOBJ(file, out_vertices, out_faces);
     return true;
 }
 
-// Render buffer to screen
-void renderBuffer(SDL_Renderer* renderer) {
-    SDL_Texture* texture = SDL_CreateTexture(renderer, 
-        SDL_PIXELFORMAT_ARGB8888, 
-        SDL_TEXTUREACCESS_STREAMING, 
-        SCREEN_WIDTH, 
-        SCREEN_HEIGHT);
-    
-    void* texturePixels;
-    int texturePitch;
-    SDL_LockTexture(texture, nullptr, &texturePixels, &texturePitch);
+// Symmetric 4x4 error quadric stored as its 10 unique coefficients
+struct Quadric {
+    double a[10];
     
-    Uint32* pixels = static_cast<Uint32*>(texturePixels);
-    for (int i = 0; i < SCREEN_WIDTH * SCREEN_HEIGHT; i++) {
-        pixels[i] = framebuffer[i].toUint32();
+    Quadric() {
+        for (int i = 0; i < 10; i++) a[i] = 0.0;
     }
     
-    SDL_UnlockTexture(texture);
-    SDL_RenderCopy(renderer, texture, nullptr, nullptr);
-    SDL_RenderPresent(renderer);
-    SDL_DestroyTexture(texture);
-}
-
-// Initialize SDL
-void init() {
-    if (SDL_Init(SDL_INIT_VIDEO) < 0) {
-        std::cerr << "SDL could not initialize! SDL_Error: " << SDL_GetError() << std::endl;
-        return;
+    // Quadric of the plane ax + by + cz + d = 0
+    static Quadric fromPlane(double pa, double pb, double pc, double pd) {
+        Quadric q;
+        q.a[0] = pa * pa; q.a[1] = pa * pb; q.a[2] = pa * pc; q.a[3] = pa * pd;
+        q.a[4] = pb * pb; q.a[5] = pb * pc; q.a[6] = pb * pd;
+        q.a[7] = pc * pc; q.a[8] = pc * pd;
+        q.a[9] = pd * pd;
+        return q;
     }
     
-    window = SDL_CreateWindow("3D OBJ Viewer - Press Arrow Keys to Rotate", 
-        SDL_WINDOWPOS_CENTERED, 
-        SDL_WINDOWPOS_CENTERED, 
-        SCREEN_WIDTH, 
-        SCREEN_HEIGHT, 
-        SDL_WINDOW_SHOWN);
+    Quadric operator+(const Quadric& other) const {
+        Quadric q;
+        for (int i = 0; i < 10; i++) q.a[i] = a[i] + other.a[i];
+        return q;
+    }
     
-    if (window == nullptr) {
-        std::cerr << "Window could not be created! SDL_Error: " << SDL_GetError() << std::endl;
-        return;
+    // Sum of squared distances from v to the accumulated planes
+    double evaluate(const Vec3& v) const {
+        double x = v.x, y = v.y, z = v.z;
+        return a[0] * x * x + 2 * a[1] * x * y + 2 * a[2] * x * z + 2 * a[3] * x
+             + a[4] * y * y + 2 * a[5] * y * z + 2 * a[6] * y
+             + a[7] * z * z + 2 * a[8] * z
+             + a[9];
     }
     
-    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
-    if (renderer == nullptr) {
-        std::cerr << "Renderer could not be created! SDL_Error: " << SDL_GetError() << std::endl;
-        return;
+    // Position minimizing the error, fails if the system is singular
+    bool optimum(Vec3& out) const {
+        double det = a[0] * (a[4] * a[7] - a[5] * a[5])
+                   - a[1] * (a[1] * a[7] - a[5] * a[2])
+                   + a[2] * (a[1] * a[5] - a[4] * a[2]);
+        if (std::fabs(det) < 1e-12) return false;
+        
+        double bx = -a[3], by = -a[6], bz = -a[8];
+        double x = (bx * (a[4] * a[7] - a[5] * a[5]) - a[1] * (by * a[7] - a[5] * bz) + a[2] * (by * a[5] - a[4] * bz)) / det;
+        double y = (a[0] * (by * a[7] - bz * a[5]) - bx * (a[1] * a[7] - a[5] * a[2]) + a[2] * (a[1] * bz - by * a[2])) / det;
+        double z = (a[0] * (a[4] * bz - a[5] * by) - a[1] * (a[1] * bz - by * a[2]) + bx * (a[1] * a[5] - a[4] * a[2])) / det;
+        out = Vec3((float)x, (float)y, (float)z);
+        return true;
     }
+};
+
+// One level of the LOD chain (level 0 is the original mesh)
+struct LODLevel {
+    std::vector<Vec3> vertices;
+    std::vector<Face> faces;
+    float error;  // Object-space geometric error of this level
+    size_t triangleCount;
+};
+
+// Candidate edge collapse, stale once either endpoint's stamp changes
+struct EdgeCollapse {
+    double cost;
+    int u, v;
+    int stampU, stampV;
+    Vec3 target;
     
-    initFramebuffer();
-    std::cout << "SDL initialized successfully!" << std::endl;
+    bool operator>(const EdgeCollapse& other) const {
+        return cost > other.cost;
+    }
+};
+
+static Vec3 cross(const Vec3& a, const Vec3& b) {
+    return Vec3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
 }
 
-// Set current color
-void setColor(const Color& color) {
-    currentColor = color;
+static float dot(const Vec3& a, const Vec3& b) {
+    return a.x * b.x + a.y * b.y + a.z * b.z;
 }
 
-// Main render function with 3D transformations
-void render(const std::vector<Vec3>& vertices, const std::vector<Face>& faces) {
-    // Clear the screen
-    clear();
+// Count triangles a face contributes when fan-triangulated
+static size_t countTriangles(const std::vector<Face>& faces) {
+    size_t count = 0;
+    for (const auto& face : faces) {
+        if (face.vertexIndices.size() >= 3) count += face.vertexIndices.size() - 2;
+    }
+    return count;
+}
+
+// Fan-triangulate valid faces into vertex index triples
+static std::vector<std::array<int, 3>> triangulate(const std::vector<Vec3>& vertices, const std::vector<Face>& faces) {
+    std::vector<std::array<int, 3>> tris;
+    for (const auto& face : faces) {
+        bool validFace = face.vertexIndices.size() >= 3;
+        for (const auto& idx : face.vertexIndices) {
+            if (idx[0] < 0 || idx[0] >= static_cast<int>(vertices.size())) validFace = false;
+        }
+        if (!validFace) continue;
+        
+        for (size_t i = 1; i + 1 < face.vertexIndices.size(); i++) {
+            std::array<int, 3> tri = {face.vertexIndices[0][0], face.vertexIndices[i][0], face.vertexIndices[i + 1][0]};
+            if (tri[0] == tri[1] || tri[1] == tri[2] || tri[2] == tri[0]) continue;
+            tris.push_back(tri);
+        }
+    }
+    return tris;
+}
+
+// Greedy quadric error metric simplifier (Garland & Heckbert).
+// Collapses the cheapest edge first; vertex v is always merged into u.
+struct MeshSimplifier {
+    std::vector<Vec3> positions;
+    std::vector<std::array<int, 3>> tris;
+    std::vector<Quadric> quadrics;
+    std::vector<std::vector<int>> vertexTris;
+    std::vector<bool> triAlive;
+    std::vector<bool> vertexAlive;
+    std::vector<int> stamp;
+    std::priority_queue<EdgeCollapse, std::vector<EdgeCollapse>, std::greater<EdgeCollapse>> heap;
+    size_t liveTris;
     
-    // Create transformation matrices
-    Mat4 modelMatrix = scale(1.0f, 1.0f, 1.0f);  // Scale the model if needed
+    MeshSimplifier(const std::vector<Vec3>& vertices, const std::vector<Face>& faces)
+        : positions(vertices), tris(triangulate(vertices, faces)), quadrics(vertices.size()),
+          vertexTris(vertices.size()), triAlive(tris.size(), true), vertexAlive(vertices.size(), true),
+          stamp(vertices.size(), 0), liveTris(tris.size()) {
+        // Accumulate the plane quadric of every triangle on its corners
+        for (size_t t = 0; t < tris.size(); t++) {
+            const Vec3& p0 = positions[tris[t][0]];
+            Vec3 n = cross(positions[tris[t][1]] - p0, positions[tris[t][2]] - p0);
+            float len = std::sqrt(dot(n, n));
+            if (len > 0.0f) {
+                n = n * (1.0f / len);
+                Quadric q = Quadric::fromPlane(n.x, n.y, n.z, -dot(n, p0));
+                for (int k = 0; k < 3; k++) quadrics[tris[t][k]] = quadrics[tris[t][k]] + q;
+            }
+            for (int k = 0; k < 3; k++) vertexTris[tris[t][k]].push_back(static_cast<int>(t));
+        }
+        
+        for (const auto& tri : tris) {
+            for (int k = 0; k < 3; k++) {
+                int u = tri[k], v = tri[(k + 1) % 3];
+                heap.push(u < v ? makeCollapse(u, v) : makeCollapse(v, u));
+            }
+        }
+    }
     
-    // Rotate the model for better viewing angle
-    Mat4 rotY = rotationY(cameraAngleY);
-    Mat4 rotX = rotationX(cameraAngleX);
-    Mat4 rotation = rotY * rotX;
+    EdgeCollapse makeCollapse(int u, int v) const {
+        EdgeCollapse c;
+        c.u = u;
+        c.v = v;
+        c.stampU = stamp[u];
+        c.stampV = stamp[v];
+        
+        Quadric q = quadrics[u] + quadrics[v];
+        Vec3 mid = (positions[u] + positions[v]) * 0.5f;
+        Vec3 half = positions[v] - mid;
+        Vec3 offset;
+        bool solved = q.optimum(c.target);
+        if (solved) offset = c.target - mid;
+        if (!solved || dot(offset, offset) > 4.0f * dot(half, half)) {
+            // Singular or ill-conditioned system: fall back to the best of endpoints and midpoint
+            Vec3 candidates[3] = {positions[u], positions[v], mid};
+            c.target = candidates[0];
+            for (int i = 1; i < 3; i++) {
+                if (q.evaluate(candidates[i]) < q.evaluate(c.target)) c.target = candidates[i];
+            }
+        }
+        c.cost = std::max(0.0, q.evaluate(c.target));
+        return c;
+    }
     
-    // Move the model back from the camera
-    Mat4 translationMat = translation(0.0f, 0.0f, -cameraDistance);
+    // Would moving `moved` to target flip a triangle that survives the collapse?
+    bool flipsTriangle(int moved, int other, const Vec3& target) const {
+        for (int t : vertexTris[moved]) {
+            if (!triAlive[t]) continue;
+            const std::array<int, 3>& tri = tris[t];
+            if (tri[0] == other || tri[1] == other || tri[2] == other) continue;
+            
+            Vec3 before[3], after[3];
+            for (int k = 0; k < 3; k++) {
+                before[k] = positions[tri[k]];
+                after[k] = (tri[k] == moved) ? target : before[k];
+            }
+            Vec3 n0 = cross(before[1] - before[0], before[2] - before[0]);
+            Vec3 n1 = cross(after[1] - after[0], after[2] - after[0]);
+            if (dot(n0, n1) <= 0.0f) return true;
+        }
+        return false;
+    }
+    
+    // Apply the cheapest valid collapse. Triangles it removes are appended to `killed`.
+    // Returns false once no collapse is left.
+    bool collapseNext(EdgeCollapse& applied, std::vector<int>* killed = nullptr) {
+        while (!heap.empty()) {
+            EdgeCollapse c = heap.top();
+            heap.pop();
+            
+            int u = c.u, v = c.v;
+            if (!vertexAlive[u] || !vertexAlive[v]) continue;
+            if (c.stampU != stamp[u] || c.stampV != stamp[v]) continue;
+            if (flipsTriangle(u, v, c.target) || flipsTriangle(v, u, c.target)) continue;
+            
+            // Collapse v into u
+            for (int t : vertexTris[v]) {
+                if (!triAlive[t]) continue;
+                std::array<int, 3>& tri = tris[t];
+                if (tri[0] == u || tri[1] == u || tri[2] == u) {
+                    triAlive[t] = false;
+                    liveTris--;
+                    if (killed) killed->push_back(t);
+                } else {
+                    for (int k = 0; k < 3; k++) {
+                        if (tri[k] == v) tri[k] = u;
+                    }
+                    vertexTris[u].push_back(t);
+                }
+            }
+            vertexAlive[v] = false;
+            vertexTris[v].clear();
+            positions[u] = c.target;
+            quadrics[u] = quadrics[u] + quadrics[v];
+            stamp[u]++;
+            
+            // Drop dead triangles and queue the edges around the merged vertex
+            std::vector<int> liveAround;
+            std::vector<int> neighbors;
+            for (int t : vertexTris[u]) {
+                if (!triAlive[t]) continue;
+                liveAround.push_back(t);
+                for (int k = 0; k < 3; k++) {
+                    int n = tris[t][k];
+                    if (n != u && std::find(neighbors.begin(), neighbors.end(), n) == neighbors.end()) {
+                        neighbors.push_back(n);
+                    }
+                }
+            }
+            vertexTris[u].swap(liveAround);
+            for (int n : neighbors) {
+                heap.push(u < n ? makeCollapse(u, n) : makeCollapse(n, u));
+            }
+            
+            applied = c;
+            return true;
+        }
+        return false;
+    }
+    
+    // Copy the live triangles into a compact LOD level
+    LODLevel snapshot(float error) const {
+        LODLevel level;
+        level.error = error;
+        std::vector<int> remap(positions.size(), -1);
+        
+        for (size_t t = 0; t < tris.size(); t++) {
+            if (!triAlive[t]) continue;
+            Face face;
+            for (int k = 0; k < 3; k++) {
+                int v = tris[t][k];
+                if (remap[v] < 0) {
+                    remap[v] = static_cast<int>(level.vertices.size());
+                    level.vertices.push_back(positions[v]);
+                }
+                std::array<int, 3> indices = {remap[v], -1, -1};
+                face.vertexIndices.push_back(indices);
+            }
+            level.faces.push_back(face);
+        }
+        
+        level.triangleCount = level.faces.size();
+        return level;
+    }
+};
+
+// Build a LOD chain with quadric error metric edge collapses.
+// Each level keeps roughly `ratio` of the previous level's triangles.
+std::vector<LODLevel> buildLODChain(const std::vector<Vec3>& vertices, const std::vector<Face>& faces,
+                                    int maxLevels = 6, float ratio = 0.5f, size_t minTriangles = 64) {
+    std::vector<LODLevel> chain;
+    
+    LODLevel base;
+    base.vertices = vertices;
+    base.faces = faces;
+    base.error = 0.0f;
+    base.triangleCount = countTriangles(faces);
+    chain.push_back(base);
+    
+    MeshSimplifier simplifier(vertices, faces);
+    float maxError = 0.0f;
+    
+    while (static_cast<int>(chain.size()) < maxLevels) {
+        size_t target = static_cast<size_t>(chain.back().triangleCount * ratio);
+        if (target < minTriangles) break;
+        
+        EdgeCollapse c;
+        while (simplifier.liveTris > target && simplifier.collapseNext(c)) {
+            maxError = std::max(maxError, static_cast<float>(std::sqrt(c.cost)));
+        }
+        
+        if (simplifier.liveTris >= chain.back().triangleCount) break;  // Nothing left to collapse
+        chain.push_back(simplifier.snapshot(maxError));
+    }
+    
+    return chain;
+}
+
+// LOD selection state
+const float CAMERA_FOV = 3.14159f / 4.0f;  // 45 degrees
+bool lodEnabled = true;
+float lodPixelThreshold = 1.0f;  // Maximum projected error in pixels
+float lodHysteresis = 0.25f;     // Coarsen only below (1 - hysteresis) * threshold
+int currentLOD = 0;
+
+// Pick a LOD level from its projected screen-space error.
+// The current level is kept unless it is too coarse or the next one is clearly good enough,
+// which avoids popping back and forth around a threshold.
+int selectLOD(const std::vector<LODLevel>& chain, float distance) {
+    float pixelsPerUnit = SCREEN_HEIGHT / (2.0f * tan(CAMERA_FOV / 2.0f) * std::max(distance, 0.1f));
+    int last = static_cast<int>(chain.size()) - 1;
+    
+    if (currentLOD > last) currentLOD = last;
+    
+    while (currentLOD > 0 && chain[currentLOD].error * pixelsPerUnit > lodPixelThreshold) {
+        currentLOD--;
+    }
+    while (currentLOD < last && chain[currentLOD + 1].error * pixelsPerUnit < lodPixelThreshold * (1.0f - lodHysteresis)) {
+        currentLOD++;
+    }
+    return currentLOD;
+}
+
+// Camera position in model space for the orbit camera
+Vec3 cameraPosition() {
+    Mat4 rotation = rotationY(cameraAngleY) * rotationX(cameraAngleX);
+    // The inverse of a rotation is its transpose, so take the third row
+    return Vec3(rotation.m[2][0], rotation.m[2][1], rotation.m[2][2]) * cameraDistance;
+}
+
+// Merge two normal cones into one bounding both
+static void mergeNormalCones(const Vec3& axisA, float angleA, const Vec3& axisB, float angleB, Vec3& axis, float& angle) {
+    const float PI = 3.14159f;
+    Vec3 sum = axisA + axisB;
+    float len = std::sqrt(dot(sum, sum));
+    if (len < 1e-6f) {
+        axis = axisA;
+        angle = PI;
+        return;
+    }
+    axis = sum * (1.0f / len);
+    float spreadA = std::acos(std::max(-1.0f, std::min(1.0f, dot(axis, axisA)))) + angleA;
+    float spreadB = std::acos(std::max(-1.0f, std::min(1.0f, dot(axis, axisB)))) + angleB;
+    angle = std::min(PI, std::max(spreadA, spreadB));
+}
+
+// Node of the progressive mesh vertex hierarchy.
+// Leaves are the original vertices; every edge collapse adds a parent of the two merged nodes.
+struct PMNode {
+    Vec3 position;
+    int parent;
+    int children[2];
+    float error;                // Object-space error, never decreases towards the root
+    float radius;               // Bounding radius of the leaves below
+    Vec3 coneAxis;              // Normal cone of the faces below
+    float coneAngle;
+    std::vector<int> killTris;  // Triangles that only exist while this node is unfolded
+};
+
+// Cut state of a hierarchy node
+enum PMNodeState {
+    PM_FOLDED,    // Below the cut, represented by an ancestor
+    PM_ACTIVE,    // On the cut, drawn as a vertex
+    PM_UNFOLDED   // Above the cut, split into its children
+};
+
+// View-dependent progressive mesh (edge-collapse hierarchy with an active cut).
+// The cut is refined or coarsened incrementally from the previous frame's cut,
+// so only nodes whose screen error crosses the threshold change each frame.
+struct ProgressiveMesh {
+    std::vector<PMNode> nodes;
+    std::vector<std::array<int, 3>> tris;  // Original triangles, corners are leaves
+    std::vector<int> state;
+    std::vector<int> activeNodes;
+    std::vector<int> activeSlot;           // Index into activeNodes, -1 if not active
+    std::vector<int> liveTris;
+    std::vector<int> liveSlot;             // Index into liveTris, -1 if not live
+    std::vector<int> cornerCache;          // Last active representative of each leaf
+    
+    // Geometry of the current cut in render() format
+    std::vector<Vec3> vertices;
+    std::vector<Face> faces;
+    
+    void build(const std::vector<Vec3>& inVertices, const std::vector<Face>& inFaces) {
+        MeshSimplifier simplifier(inVertices, inFaces);
+        size_t leafCount = inVertices.size();
+        tris = simplifier.tris;
+        
+        nodes.assign(leafCount, PMNode());
+        std::vector<Vec3> normalSum(leafCount);
+        std::vector<std::vector<Vec3>> leafNormals(leafCount);
+        for (const auto& tri : tris) {
+            const Vec3& p0 = inVertices[tri[0]];
+            Vec3 n = cross(inVertices[tri[1]] - p0, inVertices[tri[2]] - p0);
+            float len = std::sqrt(dot(n, n));
+            if (len == 0.0f) continue;
+            n = n * (1.0f / len);
+            for (int k = 0; k < 3; k++) {
+                normalSum[tri[k]] = normalSum[tri[k]] + n;
+                leafNormals[tri[k]].push_back(n);
+            }
+        }
+        
+        for (size_t i = 0; i < leafCount; i++) {
+            PMNode& node = nodes[i];
+            node.position = inVertices[i];
+            node.parent = -1;
+            node.children[0] = node.children[1] = -1;
+            node.error = 0.0f;
+            node.radius = 0.0f;
+            node.coneAngle = 3.14159f;
+            
+            float len = std::sqrt(dot(normalSum[i], normalSum[i]));
+            if (len > 1e-6f) {
+                node.coneAxis = normalSum[i] * (1.0f / len);
+                node.coneAngle = 0.0f;
+                for (const auto& n : leafNormals[i]) {
+                    node.coneAngle = std::max(node.coneAngle, std::acos(std::max(-1.0f, std::min(1.0f, dot(node.coneAxis, n)))));
+                }
+            }
+        }
+        
+        // Record every collapse as a new parent node
+        std::vector<int> nodeOf(leafCount);
+        for (size_t i = 0; i < leafCount; i++) nodeOf[i] = static_cast<int>(i);
+        std::vector<int> killNode(tris.size(), -1);
+        
+        EdgeCollapse c;
+        std::vector<int> killed;
+        while (simplifier.collapseNext(c, &killed)) {
+            int id = static_cast<int>(nodes.size());
+            PMNode node;
+            node.position = c.target;
+            node.parent = -1;
+            node.children[0] = nodeOf[c.u];
+            node.children[1] = nodeOf[c.v];
+            node.error = static_cast<float>(std::sqrt(c.cost));
+            node.radius = 0.0f;
+            for (int k = 0; k < 2; k++) {
+                const PMNode& child = nodes[node.children[k]];
+                Vec3 d = child.position - node.position;
+                node.error = std::max(node.error, child.error);
+                node.radius = std::max(node.radius, std::sqrt(dot(d, d)) + child.radius);
+            }
+            const PMNode& a = nodes[node.children[0]];
+            const PMNode& b = nodes[node.children[1]];
+            mergeNormalCones(a.coneAxis, a.coneAngle, b.coneAxis, b.coneAngle, node.coneAxis, node.coneAngle);
+            node.killTris.swap(killed);
+            for (int t : node.killTris) killNode[t] = id;
+            
+            nodes[node.children[0]].parent = id;
+            nodes[node.children[1]].parent = id;
+            nodes.push_back(node);
+            nodeOf[c.u] = id;
+            killed.clear();
+        }
+        
+        // Start from the coarsest cut: the roots and the triangles that were never collapsed
+        state.assign(nodes.size(), PM_FOLDED);
+        activeSlot.assign(nodes.size(), -1);
+        liveSlot.assign(tris.size(), -1);
+        activeNodes.clear();
+        liveTris.clear();
+        for (size_t i = 0; i < nodes.size(); i++) {
+            if (nodes[i].parent < 0) activate(static_cast<int>(i));
+        }
+        for (size_t t = 0; t < tris.size(); t++) {
+            if (killNode[t] < 0) addTriangle(static_cast<int>(t));
+        }
+        cornerCache.resize(leafCount);
+        for (size_t i = 0; i < leafCount; i++) cornerCache[i] = static_cast<int>(i);
+    }
+    
+    void activate(int n) {
+        state[n] = PM_ACTIVE;
+        activeSlot[n] = static_cast<int>(activeNodes.size());
+        activeNodes.push_back(n);
+    }
+    
+    void deactivate(int n, int newState) {
+        int slot = activeSlot[n];
+        activeNodes[slot] = activeNodes.back();
+        activeSlot[activeNodes[slot]] = slot;
+        activeNodes.pop_back();
+        activeSlot[n] = -1;
+        state[n] = newState;
+    }
+    
+    void addTriangle(int t) {
+        liveSlot[t] = static_cast<int>(liveTris.size());
+        liveTris.push_back(t);
+    }
+    
+    void removeTriangle(int t) {
+        int slot = liveSlot[t];
+        liveTris[slot] = liveTris.back();
+        liveSlot[liveTris[slot]] = slot;
+        liveTris.pop_back();
+        liveSlot[t] = -1;
+    }
+    
+    // Split an active node into its two children
+    void unfold(int n) {
+        deactivate(n, PM_UNFOLDED);
+        activate(nodes[n].children[0]);
+        activate(nodes[n].children[1]);
+        for (int t : nodes[n].killTris) addTriangle(t);
+    }
+    
+    // Merge two active siblings back into their parent
+    void fold(int n) {
+        deactivate(nodes[n].children[0], PM_FOLDED);
+        deactivate(nodes[n].children[1], PM_FOLDED);
+        activate(n);
+        for (int t : nodes[n].killTris) removeTriangle(t);
+    }
+    
+    bool canFold(int n) const {
+        return state[n] == PM_UNFOLDED &&
+               state[nodes[n].children[0]] == PM_ACTIVE &&
+               state[nodes[n].children[1]] == PM_ACTIVE;
+    }
+    
+    // Projected error in pixels, using the closest point of the node's bounding sphere
+    float screenError(int n, const Vec3& eye, float pixelsPerUnit) const {
+        Vec3 d = nodes[n].position - eye;
+        float distance = std::max(std::sqrt(dot(d, d)) - nodes[n].radius, 0.1f);
+        return nodes[n].error * pixelsPerUnit / distance;
+    }
+    
+    // True when every face below the node points away from the eye
+    bool backFacing(int n, const Vec3& eye) const {
+        const PMNode& node = nodes[n];
+        Vec3 d = node.position - eye;
+        float distance = std::sqrt(dot(d, d));
+        if (node.coneAngle >= 1.5707f || distance <= node.radius) return false;
+        
+        float viewAngle = std::acos(std::max(-1.0f, std::min(1.0f, dot(node.coneAxis, d * (1.0f / distance)))));
+        return viewAngle + node.coneAngle + std::asin(node.radius / distance) < 1.5707f;
+    }
+    
+    // Move the cut towards the view-dependent target, never exceeding `budget` triangles
+    void update(const Vec3& eye, float pixelsPerUnit, float threshold, float hysteresis, size_t budget) {
+        typedef std::pair<float, int> Candidate;
+        
+        // Coarsen nodes that are back-facing or comfortably below the threshold
+        std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> foldQueue;
+        for (int n : activeNodes) {
+            int p = nodes[n].parent;
+            if (p >= 0 && nodes[p].children[0] == n && canFold(p)) {
+                foldQueue.push(Candidate(screenError(p, eye, pixelsPerUnit), p));
+            }
+        }
+        while (!foldQueue.empty()) {
+            float error = foldQueue.top().first;
+            int p = foldQueue.top().second;
+            foldQueue.pop();
+            if (!canFold(p)) continue;
+            
+            bool overBudget = liveTris.size() > budget;
+            if (!overBudget && error >= threshold * (1.0f - hysteresis) && !backFacing(p, eye)) continue;
+            fold(p);
+            
+            int pp = nodes[p].parent;
+            if (pp >= 0 && canFold(pp)) foldQueue.push(Candidate(screenError(pp, eye, pixelsPerUnit), pp));
+        }
+        
+        // Refine the worst visible nodes first until the budget is spent
+        std::priority_queue<Candidate> refineQueue;
+        for (int n : activeNodes) {
+            if (nodes[n].children[0] < 0) continue;
+            float error = screenError(n, eye, pixelsPerUnit);
+            if (error > threshold && !backFacing(n, eye)) refineQueue.push(Candidate(error, n));
+        }
+        while (!refineQueue.empty()) {
+            int n = refineQueue.top().second;
+            refineQueue.pop();
+            if (liveTris.size() + nodes[n].killTris.size() > budget) break;
+            unfold(n);
+            
+            for (int k = 0; k < 2; k++) {
+                int child = nodes[n].children[k];
+                if (nodes[child].children[0] < 0) continue;
+                float error = screenError(child, eye, pixelsPerUnit);
+                if (error > threshold && !backFacing(child, eye)) refineQueue.push(Candidate(error, child));
+            }
+        }
+    }
+    
+    // Active node currently standing in for a leaf
+    int representative(int leaf) {
+        int n = cornerCache[leaf];
+        if (state[n] == PM_UNFOLDED) n = leaf;
+        while (state[n] != PM_ACTIVE) n = nodes[n].parent;
+        cornerCache[leaf] = n;
+        return n;
+    }
+    
+    // Rebuild vertices/faces for the current cut
+    void extract() {
+        vertices.resize(activeNodes.size());
+        for (size_t i = 0; i < activeNodes.size(); i++) vertices[i] = nodes[activeNodes[i]].position;
+        
+        faces.resize(liveTris.size());
+        for (size_t i = 0; i < liveTris.size(); i++) {
+            Face& face = faces[i];
+            face.vertexIndices.resize(3);
+            for (int k = 0; k < 3; k++) {
+                std::array<int, 3> indices = {activeSlot[representative(tris[liveTris[i]][k])], -1, -1};
+                face.vertexIndices[k] = indices;
+            }
+        }
+    }
+};
+
+// Progressive mesh state
+bool progressiveEnabled = false;
+size_t progressiveBudget = 50000;  // Maximum triangles drawn per frame
+
+// Orbit camera angles that look at the origin from direction `dir`
+static void anglesForDirection(const Vec3& dir, float& angleX, float& angleY) {
+    // Inverse of cameraPosition(): dir = (-sin Y, sin X cos Y, cos X cos Y)
+    angleY = std::atan2(-dir.x, std::sqrt(dir.y * dir.y + dir.z * dir.z));
+    angleX = std::atan2(dir.y, dir.z);
+}
+
+// Model-view-projection matrix of the orbit camera
+Mat4 orbitMVP(float angleX, float angleY, float distance, float aspect) {
+    Mat4 rotation = rotationY(angleY) * rotationX(angleX);
+    return perspective(CAMERA_FOV, aspect, 0.1f, 100.0f) * translation(0.0f, 0.0f, -distance) * rotation;
+}
+
+// Rasterize face ids with a depth test and mark every face that wins a pixel.
+// Faces crossing the near plane are marked visible without rasterizing. The sets stay
+// conservative: front faces reaching past the left or right edge are kept, and a front
+// face that wins no pixel only counts as hidden when every depth sample around its
+// bounds is nearer than its nearest vertex, so thin faces between samples survive.
+// The vertical field of view is fixed and occlusion along a view ray does not depend
+// on the aspect ratio, so the sets stay valid for any window shape.
+static void markVisibleFaces(const std::vector<Vec3>& vertices, const std::vector<Face>& faces, const Mat4& mvp,
+                             int width, int height, std::vector<uint8_t>& visible) {
+    size_t pixels = static_cast<size_t>(width) * height;
+    std::vector<float> depth(pixels, 1e30f);
+    std::vector<int> ids(pixels, -1);
+    
+    // Front faces and their screen bounds, checked against the finished depth buffer
+    struct Candidate {
+        int face;
+        int x0, y0, x1, y1;
+        float nearZ;
+    };
+    std::vector<Candidate> candidates;
+    
+    for (size_t f = 0; f < faces.size(); f++) {
+        const Face& face = faces[f];
+        if (face.vertexIndices.size() < 3) continue;
+        
+        std::vector<Vec3> screen;
+        bool crossesNear = false;
+        for (const auto& idx : face.vertexIndices) {
+            if (idx[0] < 0 || idx[0] >= static_cast<int>(vertices.size())) {
+                screen.clear();
+                break;
+            }
+            const Vec3& v = vertices[idx[0]];
+            float w = mvp.m[3][0] * v.x + mvp.m[3][1] * v.y + mvp.m[3][2] * v.z + mvp.m[3][3];
+            if (w < 0.1f) crossesNear = true;
+            Vec3 ndc = mvp.multiply(v);
+            screen.push_back(Vec3((ndc.x + 1.0f) * 0.5f * width, (1.0f - ndc.y) * 0.5f * height, ndc.z));
+        }
+        if (screen.size() < 3) continue;
+        if (crossesNear) {
+            visible[f] = 1;
+            continue;
+        }
+        
+        bool frontFacing = false;
+        for (size_t i = 1; i + 1 < screen.size(); i++) {
+            const Vec3& a = screen[0];
+            const Vec3& b = screen[i];
+            const Vec3& c = screen[i + 1];
+            
+            // Counter-clockwise in NDC is clockwise on screen (Y is flipped)
+            float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+            if (area >= 0.0f) continue;  // Back-facing or degenerate
+            frontFacing = true;
+            
+            // A wider window shows what lies past the left and right edges
+            if (std::min(a.x, std::min(b.x, c.x)) < 0.0f || std::max(a.x, std::max(b.x, c.x)) > width) visible[f] = 1;
+            
+            int minX = std::max(0, static_cast<int>(std::floor(std::min(a.x, std::min(b.x, c.x)))));
+            int maxX = std::min(width - 1, static_cast<int>(std::ceil(std::max(a.x, std::max(b.x, c.x)))));
+            int minY = std::max(0, static_cast<int>(std::floor(std::min(a.y, std::min(b.y, c.y)))));
+            int maxY = std::min(height - 1, static_cast<int>(std::ceil(std::max(a.y, std::max(b.y, c.y)))));
+            
+            for (int y = minY; y <= maxY; y++) {
+                for (int x = minX; x <= maxX; x++) {
+                    float px = x + 0.5f, py = y + 0.5f;
+                    float w0 = (c.x - b.x) * (py - b.y) - (c.y - b.y) * (px - b.x);
+                    float w1 = (a.x - c.x) * (py - c.y) - (a.y - c.y) * (px - c.x);
+                    float w2 = (b.x - a.x) * (py - a.y) - (b.y - a.y) * (px - a.x);
+                    if (w0 > 0.0f || w1 > 0.0f || w2 > 0.0f) continue;
+                    
+                    float z = (w0 * a.z + w1 * b.z + w2 * c.z) / area;
+                    int p = y * width + x;
+                    if (z < depth[p]) {
+                        depth[p] = z;
+                        ids[p] = static_cast<int>(f);
+                    }
+                }
+            }
+        }
+        if (!frontFacing || visible[f]) continue;
+        
+        Candidate candidate = {static_cast<int>(f), width, height, -1, -1, 1e30f};
+        for (const Vec3& v : screen) {
+            candidate.x0 = std::min(candidate.x0, static_cast<int>(std::floor(v.x)));
+            candidate.y0 = std::min(candidate.y0, static_cast<int>(std::floor(v.y)));
+            candidate.x1 = std::max(candidate.x1, static_cast<int>(std::ceil(v.x)));
+            candidate.y1 = std::max(candidate.y1, static_cast<int>(std::ceil(v.y)));
+            candidate.nearZ = std::min(candidate.nearZ, v.z);
+        }
+        candidates.push_back(candidate);
+    }
+    
+    for (int id : ids) {
+        if (id >= 0) visible[id] = 1;
+    }
+    
+    // A face that lost every sample may still show between them
+    for (const Candidate& candidate : candidates) {
+        if (visible[candidate.face]) continue;
+        int x0 = std::max(0, candidate.x0 - 1), x1 = std::min(width - 1, candidate.x1 + 1);
+        int y0 = std::max(0, candidate.y0 - 1), y1 = std::min(height - 1, candidate.y1 + 1);
+        for (int y = y0; y <= y1 && !visible[candidate.face]; y++) {
+            for (int x = x0; x <= x1; x++) {
+                if (depth[y * width + x] >= candidate.nearZ) {
+                    visible[candidate.face] = 1;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+// Append a run length as a little-endian base-128 varint
+static void putVarint(std::vector<uint8_t>& out, uint32_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+static uint32_t getVarint(const std::vector<uint8_t>& in, size_t& pos) {
+    uint32_t value = 0;
+    int shift = 0;
+    while (in[pos] & 0x80) {
+        value |= static_cast<uint32_t>(in[pos++] & 0x7F) << shift;
+        shift += 7;
+    }
+    value |= static_cast<uint32_t>(in[pos++]) << shift;
+    return value;
+}
+
+// Precomputed visible-face sets for view directions sampled on a sphere.
+// Each set is stored as varint run lengths of alternating hidden/visible faces.
+struct VisibilityCache {
+    std::vector<Vec3> directions;
+    std::vector<float> distances;
+    std::vector<std::vector<uint8_t>> runs;  // Indexed by band * directions.size() + direction
+    size_t faceCount = 0;
+    
+    // Scratch state reused between lookups
+    std::vector<std::pair<float, size_t>> nearest;
+    std::vector<uint8_t> mask;
+    std::vector<int> visibleFaces;
+    
+    bool empty() const {
+        return runs.empty();
+    }
+    
+    size_t compressedBytes() const {
+        size_t bytes = 0;
+        for (const auto& r : runs) bytes += r.size();
+        return bytes;
+    }
+    
+    void build(const std::vector<Vec3>& vertices, const std::vector<Face>& faces, int sampleCount,
+               const std::vector<float>& bandDistances, int height = 300) {
+        faceCount = faces.size();
+        distances = bandDistances;
+        directions.clear();
+        runs.clear();
+        
+        // Fibonacci sphere gives near-uniform direction samples
+        const float goldenAngle = 3.14159f * (3.0f - std::sqrt(5.0f));
+        for (int i = 0; i < sampleCount; i++) {
+            float y = 1.0f - 2.0f * (i + 0.5f) / sampleCount;
+            float r = std::sqrt(std::max(0.0f, 1.0f - y * y));
+            directions.push_back(Vec3(std::cos(goldenAngle * i) * r, y, std::sin(goldenAngle * i) * r));
+        }
+        
+        // Sampled wider than most windows so few faces fall past the side edges
+        float aspect = std::max(3.0f, (float)SCREEN_WIDTH / (float)SCREEN_HEIGHT);
+        int width = static_cast<int>(height * aspect);
+        std::vector<uint8_t> visible(faceCount);
+        for (float distance : distances) {
+            for (const auto& dir : directions) {
+                float angleX, angleY;
+                anglesForDirection(dir, angleX, angleY);
+                std::fill(visible.begin(), visible.end(), 0);
+                markVisibleFaces(vertices, faces, orbitMVP(angleX, angleY, distance, aspect), width, height, visible);
+                
+                std::vector<uint8_t> r;
+                uint8_t current = 0;
+                uint32_t length = 0;
+                for (size_t f = 0; f < faceCount; f++) {
+                    if (visible[f] != current) {
+                        putVarint(r, length);
+                        current = visible[f];
+                        length = 0;
+                    }
+                    length++;
+                }
+                putVarint(r, length);
+                runs.push_back(r);
+            }
+        }
+    }
+    
+    // Faces visible from any of the `neighbors` sampled directions nearest to the eye
+    const std::vector<int>& lookup(const Vec3& eye, int neighbors) {
+        float eyeDistance = std::sqrt(dot(eye, eye));
+        Vec3 dir = eye * (1.0f / std::max(eyeDistance, 1e-6f));
+        
+        size_t band = 0;
+        for (size_t b = 1; b < distances.size(); b++) {
+            if (std::fabs(std::log(distances[b] / eyeDistance)) < std::fabs(std::log(distances[band] / eyeDistance))) band = b;
+        }
+        
+        nearest.clear();
+        for (size_t i = 0; i < directions.size(); i++) {
+            nearest.push_back(std::make_pair(-dot(directions[i], dir), i));
+        }
+        size_t count = std::min(nearest.size(), static_cast<size_t>(neighbors));
+        std::partial_sort(nearest.begin(), nearest.begin() + count, nearest.end());
+        
+        mask.assign(faceCount, 0);
+        for (size_t n = 0; n < count; n++) {
+            const std::vector<uint8_t>& r = runs[band * directions.size() + nearest[n].second];
+            size_t f = 0, pos = 0;
+            bool visibleRun = false;
+            while (pos < r.size()) {
+                uint32_t length = getVarint(r, pos);
+                if (visibleRun) std::fill(mask.begin() + f, mask.begin() + f + length, 1);
+                f += length;
+                visibleRun = !visibleRun;
+            }
+        }
+        
+        visibleFaces.clear();
+        for (size_t f = 0; f < faceCount; f++) {
+            if (mask[f]) visibleFaces.push_back(static_cast<int>(f));
+        }
+        return visibleFaces;
+    }
+};
+
+// Visibility cache state
+bool visibilityCacheEnabled = false;
+int visibilitySamples = 256;
+int visibilityNeighbors = 3;  // Nearest samples whose sets are merged
+
+// Edge between two faces (face1 is -1 on open boundaries)
+struct MeshEdge {
+    int v0, v1;
+    int face0, face1;
+};
+
+// Edge and face-to-face adjacency of a polygon mesh.
+// Non-manifold edges are linked as a chain of face pairs.
+struct MeshAdjacency {
+    std::vector<MeshEdge> edges;
+    std::vector<std::vector<int>> faceEdges;
+    std::vector<std::vector<int>> faceNeighbors;
+    std::vector<int> creaseEdges;     // Edges whose dihedral angle exceeds the crease threshold
+    std::vector<int> boundaryEdges;   // Edges with a single face (open borders)
+    std::vector<Vec3> faceNormals;    // Unnormalized, from the first three corners like render()
+    std::vector<float> faceOffsets;   // Plane offset dot(normal, corner0)
+    std::vector<uint8_t> faceValid;
+    float creaseAngle = 0.5236f;      // 30 degrees
+    
+    void build(const std::vector<Vec3>& vertices, const std::vector<Face>& faces) {
+        edges.clear();
+        boundaryEdges.clear();
+        faceEdges.assign(faces.size(), std::vector<int>());
+        faceNeighbors.assign(faces.size(), std::vector<int>());
+        faceNormals.assign(faces.size(), Vec3());
+        faceOffsets.assign(faces.size(), 0.0f);
+        faceValid.assign(faces.size(), 0);
+        
+        // Sort (edge, face) records so faces sharing an edge end up adjacent
+        std::vector<std::pair<std::pair<int, int>, int>> records;
+        for (size_t f = 0; f < faces.size(); f++) {
+            const auto& idx = faces[f].vertexIndices;
+            bool validFace = idx.size() >= 3;
+            for (const auto& corner : idx) {
+                if (corner[0] < 0 || corner[0] >= static_cast<int>(vertices.size())) validFace = false;
+            }
+            if (!validFace) continue;
+            
+            faceValid[f] = 1;
+            const Vec3& p0 = vertices[idx[0][0]];
+            faceNormals[f] = cross(vertices[idx[1][0]] - p0, vertices[idx[2][0]] - p0);
+            faceOffsets[f] = dot(faceNormals[f], p0);
+            
+            for (size_t k = 0; k < idx.size(); k++) {
+                int a = idx[k][0], b = idx[(k + 1) % idx.size()][0];
+                if (a == b) continue;
+                records.push_back(std::make_pair(std::make_pair(std::min(a, b), std::max(a, b)), static_cast<int>(f)));
+            }
+        }
+        std::sort(records.begin(), records.end());
+        
+        for (size_t i = 0; i < records.size();) {
+            size_t j = i + 1;
+            while (j < records.size() && records[j].first == records[i].first) j++;
+            
+            MeshEdge edge;
+            edge.v0 = records[i].first.first;
+            edge.v1 = records[i].first.second;
+            edge.face0 = records[i].second;
+            edge.face1 = -1;
+            if (j == i + 1) {
+                boundaryEdges.push_back(static_cast<int>(edges.size()));
+                faceEdges[edge.face0].push_back(static_cast<int>(edges.size()));
+                edges.push_back(edge);
+            }
+            for (size_t k = i + 1; k < j; k++) {
+                edge.face0 = records[k - 1].second;
+                edge.face1 = records[k].second;
+                if (edge.face0 == edge.face1) continue;
+                faceEdges[edge.face0].push_back(static_cast<int>(edges.size()));
+                faceEdges[edge.face1].push_back(static_cast<int>(edges.size()));
+                edges.push_back(edge);
+                faceNeighbors[edge.face0].push_back(edge.face1);
+                faceNeighbors[edge.face1].push_back(edge.face0);
+            }
+            i = j;
+        }
+        
+        findCreases(creaseAngle);
+    }
+    
+    // Collect edges between faces meeting at more than `angle` radians
+    void findCreases(float angle) {
+        creaseAngle = angle;
+        creaseEdges.clear();
+        float cosLimit = std::cos(angle);
+        for (size_t e = 0; e < edges.size(); e++) {
+            const MeshEdge& edge = edges[e];
+            if (edge.face1 < 0) continue;
+            const Vec3& n0 = faceNormals[edge.face0];
+            const Vec3& n1 = faceNormals[edge.face1];
+            float len = std::sqrt(dot(n0, n0) * dot(n1, n1));
+            if (len > 0.0f && dot(n0, n1) < cosLimit * len) creaseEdges.push_back(static_cast<int>(e));
+        }
+    }
+    
+    bool frontFacing(int f, const Vec3& eye) const {
+        return faceValid[f] && dot(faceNormals[f], eye) > faceOffsets[f];
+    }
+};
+
+// Back-face culling that reuses the previous frame's result.
+// Faces are re-tested by flooding through the adjacency from the old silhouette
+// across faces that flipped. A face away from the silhouette can only have flipped
+// once the eye has been as far from the last full pass as its plane distance then,
+// so faces within the farthest travel so far seed the flood too. That covers new
+// silhouette loops and faces flipping back as the eye returns.
+struct CoherentCuller {
+    const MeshAdjacency* adjacency = nullptr;
+    std::vector<uint8_t> front;
+    std::vector<int> visibleFaces;
+    std::vector<int> visibleSlot;     // Index into visibleFaces, -1 when culled
+    std::vector<int> frontier;        // Faces with a neighbor of opposite facing
+    std::vector<int> testedFrame;     // Last frame each face was tested
+    std::vector<int> byPlaneDistance; // Faces sorted by eye-plane distance at the last full pass
+    std::vector<float> planeDistance; // Matching sorted distances
+    Vec3 fullEye;
+    Vec3 lastEye;
+    float maxTravel = 0.0f;           // Farthest the eye has been from fullEye since the full pass
+    int frame = 0;
+    int lastFullFrame = -1;
+    size_t lastTested = 0;            // Faces tested by the last update
+    
+    float maxStepAngle = 0.25f;        // Radians of view change handled incrementally
+    float maxDistanceRatio = 1.2f;
+    float maxSeedFraction = 0.25f;     // Full pass once this share of faces may have flipped
+    int fullRefreshInterval = 120;     // Frames between forced full passes
+    
+    void reset(const MeshAdjacency& adj) {
+        adjacency = &adj;
+        size_t faceCount = adj.faceValid.size();
+        front.assign(faceCount, 0);
+        visibleSlot.assign(faceCount, -1);
+        testedFrame.assign(faceCount, -1);
+        visibleFaces.clear();
+        frontier.clear();
+        lastFullFrame = -1;
+    }
+    
+    void setFacing(int f, bool isFront) {
+        if (front[f] == isFront) return;
+        front[f] = isFront;
+        if (isFront) {
+            visibleSlot[f] = static_cast<int>(visibleFaces.size());
+            visibleFaces.push_back(f);
+        } else {
+            int slot = visibleSlot[f];
+            visibleFaces[slot] = visibleFaces.back();
+            visibleSlot[visibleFaces[slot]] = slot;
+            visibleFaces.pop_back();
+            visibleSlot[f] = -1;
+        }
+    }
+    
+    bool onFrontier(int f) const {
+        for (int n : adjacency->faceNeighbors[f]) {
+            if (front[n] != front[f]) return true;
+        }
+        return false;
+    }
+    
+    bool needsFullPass(const Vec3& eye) const {
+        if (lastFullFrame < 0 || frame - lastFullFrame >= fullRefreshInterval) return true;
+        
+        float lenA = std::sqrt(dot(eye, eye)), lenB = std::sqrt(dot(lastEye, lastEye));
+        if (lenA < 1e-6f || lenB < 1e-6f) return true;
+        float cosine = dot(eye, lastEye) / (lenA * lenB);
+        if (cosine < std::cos(maxStepAngle)) return true;
+        return std::max(lenA, lenB) > maxDistanceRatio * std::min(lenA, lenB);
+    }
+    
+    void fullPass(const Vec3& eye) {
+        size_t faceCount = front.size();
+        std::vector<std::pair<float, int>> distances(faceCount);
+        for (size_t f = 0; f < faceCount; f++) {
+            setFacing(static_cast<int>(f), adjacency->frontFacing(static_cast<int>(f), eye));
+            
+            const Vec3& n = adjacency->faceNormals[f];
+            float len = std::sqrt(dot(n, n));
+            float distance = len > 0.0f ? std::fabs(dot(n, eye) - adjacency->faceOffsets[f]) / len : 0.0f;
+            distances[f] = std::make_pair(distance, static_cast<int>(f));
+        }
+        std::sort(distances.begin(), distances.end());
+        byPlaneDistance.resize(faceCount);
+        planeDistance.resize(faceCount);
+        for (size_t i = 0; i < faceCount; i++) {
+            planeDistance[i] = distances[i].first;
+            byPlaneDistance[i] = distances[i].second;
+        }
+        
+        frontier.clear();
+        for (size_t f = 0; f < faceCount; f++) {
+            if (onFrontier(static_cast<int>(f))) frontier.push_back(static_cast<int>(f));
+        }
+        fullEye = eye;
+        lastEye = eye;
+        maxTravel = 0.0f;
+        lastFullFrame = frame;
+        lastTested = faceCount;
+    }
+    
+    const std::vector<int>& update(const Vec3& eye) {
+        frame++;
+        size_t faceCount = front.size();
+        
+        // Faces whose plane was within the farthest travel since the last full pass.
+        // The eye stayed inside that ball, so planes outside it were never crossed.
+        size_t seedCount = 0;
+        if (lastFullFrame >= 0) {
+            Vec3 travel = eye - fullEye;
+            maxTravel = std::max(maxTravel, std::sqrt(dot(travel, travel)));
+            float reach = maxTravel * 1.001f + 1e-5f;  // Slack for float rounding in the distances
+            seedCount = std::upper_bound(planeDistance.begin(), planeDistance.end(), reach) - planeDistance.begin();
+        }
+        
+        if (needsFullPass(eye) || seedCount > maxSeedFraction * faceCount) {
+            fullPass(eye);
+            return visibleFaces;
+        }
+        
+        // Flood outwards from the old silhouette through faces that changed facing
+        std::vector<int> tested;
+        std::vector<int> work(frontier);
+        for (int f : work) testedFrame[f] = frame;
+        for (size_t i = 0; i < seedCount; i++) {
+            int f = byPlaneDistance[i];
+            if (testedFrame[f] != frame) {
+                testedFrame[f] = frame;
+                work.push_back(f);
+            }
+        }
+        while (!work.empty()) {
+            int f = work.back();
+            work.pop_back();
+            tested.push_back(f);
+            
+            bool isFront = adjacency->frontFacing(f, eye);
+            if (isFront == (front[f] != 0)) continue;
+            setFacing(f, isFront);
+            for (int n : adjacency->faceNeighbors[f]) {
+                if (testedFrame[n] != frame) {
+                    testedFrame[n] = frame;
+                    work.push_back(n);
+                }
+            }
+        }
+        
+        // The new silhouette can only border faces that were just tested
+        frontier.clear();
+        for (int f : tested) {
+            if (testedFrame[f] == -frame) continue;
+            if (onFrontier(f)) {
+                frontier.push_back(f);
+                testedFrame[f] = -frame;
+            }
+            for (int n : adjacency->faceNeighbors[f]) {
+                if (testedFrame[n] != frame && testedFrame[n] != -frame && onFrontier(n)) {
+                    frontier.push_back(n);
+                    testedFrame[n] = -frame;
+                }
+            }
+        }
+        
+        lastEye = eye;
+        lastTested = tested.size();
+        return visibleFaces;
+    }
+};
+
+// Coherent culling state
+bool coherentCullingEnabled = false;
+
+// Outline preview state
+bool edgePreviewEnabled = false;
+size_t edgePreviewLines = 0;  // Lines drawn by the last outline frame
+
+// Loaded model representations
+std::vector<LODLevel> lodChain;
+ProgressiveMesh progressiveMesh;
+VisibilityCache visibilityCache;
+MeshAdjacency meshAdjacency;
+CoherentCuller coherentCuller;
+
+// How frames reach the screen
+enum PresentStrategy {
+    PRESENT_RECREATE_TEXTURE,    // Create and destroy a texture every frame
+    PRESENT_PERSISTENT_TEXTURE,  // Upload the framebuffer into one long-lived texture
+    PRESENT_DIRECT_TO_TEXTURE,   // Rasterize straight into the locked texture memory
+    PRESENT_WINDOW_SURFACE       // No renderer: draw into the window surface (software machines)
+};
+
+PresentStrategy presentStrategy = PRESENT_PERSISTENT_TEXTURE;
+SDL_Texture* streamingTexture = nullptr;
+int streamingTextureWidth = 0;
+int streamingTextureHeight = 0;
+bool streamingTextureLocked = false;
+bool windowSurfaceLocked = false;
+bool forceWindowSurface = false;  // Skip the accelerated renderer even if one exists
+
+const char* presentStrategyName(PresentStrategy strategy) {
+    switch (strategy) {
+        case PRESENT_RECREATE_TEXTURE: return "recreate texture";
+        case PRESENT_PERSISTENT_TEXTURE: return "persistent texture";
+        case PRESENT_DIRECT_TO_TEXTURE: return "direct to texture";
+        case PRESENT_WINDOW_SURFACE: return "window surface";
+    }
+    return "unknown";
+}
+
+// Create the streaming texture, or recreate it when the size changed
+bool ensureStreamingTexture(SDL_Renderer* renderer, int width, int height) {
+    if (streamingTexture && streamingTextureWidth == width && streamingTextureHeight == height) return true;
+    
+    if (streamingTexture) SDL_DestroyTexture(streamingTexture);
+    streamingTexture = SDL_CreateTexture(renderer,
+        SDL_PIXELFORMAT_ARGB8888,
+        SDL_TEXTUREACCESS_STREAMING,
+        width,
+        height);
+    if (streamingTexture == nullptr) {
+        std::cerr << "Streaming texture could not be created! SDL_Error: " << SDL_GetError() << std::endl;
+        return false;
+    }
+    streamingTextureWidth = width;
+    streamingTextureHeight = height;
+    return true;
+}
+
+// Can the window surface hold our ARGB8888 pixels as they are?
+bool surfaceMatchesFramebuffer(SDL_Surface* surface) {
+    return surface && surface->w == SCREEN_WIDTH && surface->h == SCREEN_HEIGHT &&
+           (surface->format->format == SDL_PIXELFORMAT_ARGB8888 || surface->format->format == SDL_PIXELFORMAT_RGB888);
+}
+
+// Show a texture stretched over the window
+void presentTexture(SDL_Renderer* renderer, SDL_Texture* texture) {
+    StageTimer timer(STAGE_PRESENT);
+    SDL_RenderCopy(renderer, texture, nullptr, nullptr);
+    SDL_RenderPresent(renderer);
+}
+
+// Show the window surface, whole or just one rectangle of it
+void presentSurface(const DirtyRect& rect, bool wholeWindow) {
+    StageTimer timer(STAGE_PRESENT);
+    if (wholeWindow) {
+        SDL_UpdateWindowSurface(window);
+    } else if (!rect.empty()) {
+        SDL_Rect sdlRect = {rect.x0, rect.y0, rect.width(), rect.height()};
+        SDL_UpdateWindowSurfaceRects(window, &sdlRect, 1);
+    }
+}
+
+// Point drawing at the memory the frame will be presented from
+void beginFrame(SDL_Renderer* renderer) {
+    if (monochromeEnabled || tiledEnabled) return;  // Lines go to the bitplane or the tiles
+    if (presentStrategy == PRESENT_WINDOW_SURFACE && !windowSurfaceLocked) {
+        SDL_Surface* surface = SDL_GetWindowSurface(window);
+        if (!surfaceMatchesFramebuffer(surface)) return;  // Converted at present time instead
+        if (SDL_MUSTLOCK(surface) && SDL_LockSurface(surface) < 0) return;
+        
+        drawTarget.pixels = static_cast<uint32_t*>(surface->pixels);
+        drawTarget.stride = surface->pitch / static_cast<int>(sizeof(uint32_t));
+        windowSurfaceLocked = true;
+        return;
+    }
+    if (presentStrategy != PRESENT_DIRECT_TO_TEXTURE || streamingTextureLocked) return;
+    if (!ensureStreamingTexture(renderer, SCREEN_WIDTH, SCREEN_HEIGHT)) return;
+    
+    void* texturePixels;
+    int texturePitch;
+    if (SDL_LockTexture(streamingTexture, nullptr, &texturePixels, &texturePitch) < 0) return;
+    
+    drawTarget.pixels = static_cast<uint32_t*>(texturePixels);
+    drawTarget.stride = texturePitch / static_cast<int>(sizeof(uint32_t));
+    streamingTextureLocked = true;
+}
+
+// Region of the framebuffer that has to reach the screen this frame
+DirtyRect presentRect() {
+    bool tracked = dirtyRectsEnabled && dirtyHistoryValid &&
+                   (presentStrategy == PRESENT_PERSISTENT_TEXTURE || presentStrategy == PRESENT_WINDOW_SURFACE);
+    if (!tracked) return DirtyRect(0, 0, SCREEN_WIDTH - 1, SCREEN_HEIGHT - 1);
+    // Erase what the screen still shows from last frame and add what is new
+    return previousDirty.unite(frameDirty);
+}
+
+// Roll the dirty history over once a frame has been presented
+void endFrameDirty(const DirtyRect& uploaded) {
+    bytesUploaded = uploaded.area() * sizeof(uint32_t);
+    previousDirty = frameDirty;
+    frameDirty = DirtyRect();
+    // Locked texture memory is undefined on the next lock, so that path always redraws fully
+    dirtyHistoryValid = presentStrategy == PRESENT_PERSISTENT_TEXTURE || presentStrategy == PRESENT_WINDOW_SURFACE;
+}
+
+// Present the monochrome bitplane, expanding it straight into the destination pixels
+void presentMonochrome(SDL_Renderer* renderer) {
+    // The framebuffer and screen no longer match the dirty history
+    dirtyHistoryValid = false;
+    bytesUploaded = static_cast<size_t>(SCREEN_WIDTH) * SCREEN_HEIGHT * sizeof(uint32_t);
+    
+    if (presentStrategy == PRESENT_WINDOW_SURFACE) {
+        SDL_Surface* surface = SDL_GetWindowSurface(window);
+        if (surface == nullptr) return;
+        
+        // Writing into the window surface is this path's upload
+        StageTimer uploadTimer(STAGE_UPLOAD);
+        CounterScope counters(STAGE_UPLOAD);
+        if (surfaceMatchesFramebuffer(surface)) {
+            if (SDL_MUSTLOCK(surface)) SDL_LockSurface(surface);
+            PixelView view = {static_cast<uint32_t*>(surface->pixels), SCREEN_WIDTH, SCREEN_HEIGHT,
+                              surface->pitch / static_cast<int>(sizeof(uint32_t))};
+            expandBitplane(view, currentPixel, BACKGROUND_PIXEL);
+            if (SDL_MUSTLOCK(surface)) SDL_UnlockSurface(surface);
+        } else {
+            PixelView view = {framebuffer.data(), SCREEN_WIDTH, SCREEN_HEIGHT, SCREEN_WIDTH};
+            expandBitplane(view, currentPixel, BACKGROUND_PIXEL);
+            if (surface->w != SCREEN_WIDTH || surface->h != SCREEN_HEIGHT) {
+                blitScaledToSurface(framebuffer.data(), SCREEN_WIDTH, surface);
+            } else {
+                StageTimer timer(STAGE_CONVERT);
+                if (SDL_MUSTLOCK(surface)) SDL_LockSurface(surface);
+                SDL_ConvertPixels(SCREEN_WIDTH, SCREEN_HEIGHT,
+                    SDL_PIXELFORMAT_ARGB8888, framebuffer.data(), SCREEN_WIDTH * sizeof(uint32_t),
+                    surface->format->format, surface->pixels, surface->pitch);
+                if (SDL_MUSTLOCK(surface)) SDL_UnlockSurface(surface);
+            }
+        }
+        counters.stop();
+        presentSurface(DirtyRect(), true);
+        return;
+    }
+    
+    if (!ensureStreamingTexture(renderer, SCREEN_WIDTH, SCREEN_HEIGHT)) return;
+    
+    {
+        StageTimer timer(STAGE_UPLOAD);
+        CounterScope counters(STAGE_UPLOAD);
+        void* texturePixels;
+        int texturePitch;
+        if (SDL_LockTexture(streamingTexture, nullptr, &texturePixels, &texturePitch) < 0) return;
+        PixelView view = {static_cast<uint32_t*>(texturePixels), SCREEN_WIDTH, SCREEN_HEIGHT,
+                          texturePitch / static_cast<int>(sizeof(uint32_t))};
+        expandBitplane(view, currentPixel, BACKGROUND_PIXEL);
+        SDL_UnlockTexture(streamingTexture);
+    }
+    
+    presentTexture(renderer, streamingTexture);
+}
+
+// Present the tiled framebuffer, detiling straight into the destination pixels.
+// Every texture strategy goes through the streaming texture here.
+void presentTiled(SDL_Renderer* renderer) {
+    DirtyRect full(0, 0, SCREEN_WIDTH - 1, SCREEN_HEIGHT - 1);
+    DirtyRect rect = (dirtyRectsEnabled && dirtyHistoryValid) ? previousDirty.unite(frameDirty) : full;
+    bool fused = fusedClearEnabled && rect.area() == full.area();
+    
+    if (presentStrategy == PRESENT_WINDOW_SURFACE) {
+        SDL_Surface* surface = SDL_GetWindowSurface(window);
+        if (surface == nullptr) return;
+        
+        StageTimer uploadTimer(STAGE_UPLOAD);
+        CounterScope counters(STAGE_UPLOAD);
+        if (surface->w != SCREEN_WIDTH || surface->h != SCREEN_HEIGHT) {
+            // Detile the whole frame and stretch it over the window
+            rect = full;
+            fused = fusedClearEnabled;
+            detileScratch.resize(full.area());
+            PixelView view = {detileScratch.data(), SCREEN_WIDTH, SCREEN_HEIGHT, SCREEN_WIDTH};
+            detile(view, rect, fused);
+            blitScaledToSurface(detileScratch.data(), SCREEN_WIDTH, surface);
+        } else if (!rect.empty()) {
+            if (SDL_MUSTLOCK(surface)) SDL_LockSurface(surface);
+            if (surfaceMatchesFramebuffer(surface)) {
+                int pitch = surface->pitch / static_cast<int>(sizeof(uint32_t));
+                PixelView view = {static_cast<uint32_t*>(surface->pixels) + rect.y0 * pitch + rect.x0,
+                                  rect.width(), rect.height(), pitch};
+                detile(view, rect, fused);
+            } else {
+                StageTimer timer(STAGE_CONVERT);
+                rect = DirtyRect(rect.x0, rect.y0, std::min(rect.x1, surface->w - 1), std::min(rect.y1, surface->h - 1));
+                detileScratch.resize(rect.area());
+                PixelView view = {detileScratch.data(), rect.width(), rect.height(), rect.width()};
+                detile(view, rect, false);
+                SDL_ConvertPixels(rect.width(), rect.height(),
+                    SDL_PIXELFORMAT_ARGB8888, detileScratch.data(), rect.width() * sizeof(uint32_t),
+                    surface->format->format, static_cast<Uint8*>(surface->pixels) + rect.y0 * surface->pitch + rect.x0 * surface->format->BytesPerPixel,
+                    surface->pitch);
+                fused = false;
+            }
+            if (SDL_MUSTLOCK(surface)) SDL_UnlockSurface(surface);
+        }
+        counters.stop();
+        
+        presentSurface(rect, rect.area() == full.area());
+    } else {
+        if (!ensureStreamingTexture(renderer, SCREEN_WIDTH, SCREEN_HEIGHT)) return;
+        
+        void* texturePixels;
+        int texturePitch;
+        SDL_Rect sdlRect = {rect.x0, rect.y0, rect.width(), rect.height()};
+        StageTimer uploadTimer(STAGE_UPLOAD);
+        CounterScope counters(STAGE_UPLOAD);
+        if (!rect.empty() && SDL_LockTexture(streamingTexture, &sdlRect, &texturePixels, &texturePitch) == 0) {
+            PixelView view = {static_cast<uint32_t*>(texturePixels), rect.width(), rect.height(),
+                              texturePitch / static_cast<int>(sizeof(uint32_t))};
+            detile(view, rect, fused);
+            SDL_UnlockTexture(streamingTexture);
+        } else {
+            fused = false;
+        }
+        counters.stop();
+        presentTexture(renderer, streamingTexture);
+    }
+    
+    framebufferPreCleared = fused;
+    endFrameDirty(rect);
+    // Only rectangles are ever locked and written, so the destination keeps the rest
+    dirtyHistoryValid = true;
+}
+
+// Render buffer to screen
+void renderBuffer(SDL_Renderer* renderer) {
+    TraceZone zone("renderBuffer");
+    stageProfiling[1] = SDL_AtomicGet(&profilerEnabled) != 0;
+    if (monochromeEnabled) {
+        presentMonochrome(renderer);
+        return;
+    }
+    if (tiledEnabled) {
+        presentTiled(renderer);
+        return;
+    }
+    
+    if (presentStrategy == PRESENT_WINDOW_SURFACE) {
+        SDL_Surface* surface = SDL_GetWindowSurface(window);
+        if (surface == nullptr) return;
+        
+        bool scaled = surface->w != SCREEN_WIDTH || surface->h != SCREEN_HEIGHT;
+        DirtyRect rect = scaled ? DirtyRect(0, 0, SCREEN_WIDTH - 1, SCREEN_HEIGHT - 1) : presentRect();
+        if (!rect.empty() && !scaled) {
+            rect = DirtyRect(rect.x0, rect.y0, std::min(rect.x1, surface->w - 1), std::min(rect.y1, surface->h - 1));
+        }
+        
+        StageTimer uploadTimer(STAGE_UPLOAD);
+        CounterScope counters(STAGE_UPLOAD);
+        if (windowSurfaceLocked) {
+            if (SDL_MUSTLOCK(surface)) SDL_UnlockSurface(surface);
+            windowSurfaceLocked = false;
+            drawTarget.pixels = framebuffer.data();
+            drawTarget.stride = SCREEN_WIDTH;
+        } else if (scaled) {
+            blitScaledToSurface(framebuffer.data(), SCREEN_WIDTH, surface);
+        } else if (!rect.empty()) {
+            // Surface has another size or format: convert into it
+            StageTimer timer(STAGE_CONVERT);
+            if (SDL_MUSTLOCK(surface)) SDL_LockSurface(surface);
+            SDL_ConvertPixels(rect.width(), rect.height(),
+                SDL_PIXELFORMAT_ARGB8888, &framebuffer[rect.y0 * SCREEN_WIDTH + rect.x0], SCREEN_WIDTH * sizeof(uint32_t),
+                surface->format->format, static_cast<Uint8*>(surface->pixels) + rect.y0 * surface->pitch + rect.x0 * surface->format->BytesPerPixel,
+                surface->pitch);
+            if (SDL_MUSTLOCK(surface)) SDL_UnlockSurface(surface);
+        }
+        counters.stop();
+        
+        presentSurface(rect, !(dirtyRectsEnabled && dirtyHistoryValid && !scaled));
+        endFrameDirty(rect);
+        return;
+    }
+    
+    if (presentStrategy == PRESENT_RECREATE_TEXTURE) {
+        StageTimer uploadTimer(STAGE_UPLOAD);
+        CounterScope counters(STAGE_UPLOAD);
+        SDL_Texture* texture = SDL_CreateTexture(renderer, 
+            SDL_PIXELFORMAT_ARGB8888, 
+            SDL_TEXTUREACCESS_STREAMING, 
+            SCREEN_WIDTH, 
+            SCREEN_HEIGHT);
+        
+        void* texturePixels;
+        int texturePitch;
+        SDL_LockTexture(texture, nullptr, &texturePixels, &texturePitch);
+        
+        // The framebuffer is already ARGB8888, so this is a plain copy
+        Uint8* pixels = static_cast<Uint8*>(texturePixels);
+        size_t rowBytes = SCREEN_WIDTH * sizeof(uint32_t);
+        for (int y = 0; y < SCREEN_HEIGHT; y++) {
+            memcpy(pixels + y * texturePitch, &framebuffer[y * SCREEN_WIDTH], rowBytes);
+        }
+        
+        SDL_UnlockTexture(texture);
+        counters.stop();
+        presentTexture(renderer, texture);
+        SDL_DestroyTexture(texture);
+        endFrameDirty(DirtyRect(0, 0, SCREEN_WIDTH - 1, SCREEN_HEIGHT - 1));
+        return;
+    }
+    
+    if (!ensureStreamingTexture(renderer, SCREEN_WIDTH, SCREEN_HEIGHT)) return;
+    
+    DirtyRect rect = presentRect();
+    StageTimer uploadTimer(STAGE_UPLOAD);
+    CounterScope counters(STAGE_UPLOAD);
+    if (streamingTextureLocked) {
+        // Pixels were drawn in place; unlocking hands them to the renderer
+        SDL_UnlockTexture(streamingTexture);
+        streamingTextureLocked = false;
+        drawTarget.pixels = framebuffer.data();
+        drawTarget.stride = SCREEN_WIDTH;
+        rect = DirtyRect(0, 0, SCREEN_WIDTH - 1, SCREEN_HEIGHT - 1);
+    } else if (fusedClearEnabled && rect.area() == static_cast<size_t>(SCREEN_WIDTH) * SCREEN_HEIGHT) {
+        // Full upload: copy out and clear in one pass over the framebuffer
+        void* texturePixels;
+        int texturePitch;
+        if (SDL_LockTexture(streamingTexture, nullptr, &texturePixels, &texturePitch) == 0) {
+            PixelView view = {static_cast<uint32_t*>(texturePixels), SCREEN_WIDTH, SCREEN_HEIGHT,
+                              texturePitch / static_cast<int>(sizeof(uint32_t))};
+            copyAndClear(view, framebuffer.data(), SCREEN_WIDTH);
+            SDL_UnlockTexture(streamingTexture);
+            framebufferPreCleared = true;
+        }
+    } else if (!rect.empty()) {
+        SDL_Rect sdlRect = {rect.x0, rect.y0, rect.width(), rect.height()};
+        SDL_UpdateTexture(streamingTexture, &sdlRect, &framebuffer[rect.y0 * SCREEN_WIDTH + rect.x0], SCREEN_WIDTH * sizeof(uint32_t));
+    }
+    counters.stop();
+    
+    presentTexture(renderer, streamingTexture);
+    endFrameDirty(rect);
+}
+
+// Initialize SDL
+void init() {
+    if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+        std::cerr << "SDL could not initialize! SDL_Error: " << SDL_GetError() << std::endl;
+        return;
+    }
+    
+    window = SDL_CreateWindow("3D OBJ Viewer - Press Arrow Keys to Rotate", 
+        SDL_WINDOWPOS_CENTERED, 
+        SDL_WINDOWPOS_CENTERED, 
+        windowWidth, 
+        windowHeight, 
+        SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE);
+    
+    if (window == nullptr) {
+        std::cerr << "Window could not be created! SDL_Error: " << SDL_GetError() << std::endl;
+        return;
+    }
+    
+    if (!forceWindowSurface) {
+        renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+        
+        // Some drivers hand back a software renderer; the surface path saves a copy there
+        SDL_RendererInfo info;
+        if (renderer != nullptr && (SDL_GetRendererInfo(renderer, &info) < 0 || !(info.flags & SDL_RENDERER_ACCELERATED))) {
+            SDL_DestroyRenderer(renderer);
+            renderer = nullptr;
+        }
+    }
+    
+    initFramebuffer();
+    
+    if (renderer == nullptr) {
+        std::cout << "No accelerated renderer, presenting to the window surface" << std::endl;
+        SDL_SetHint(SDL_HINT_FRAMEBUFFER_ACCELERATION, "0");
+        if (SDL_GetWindowSurface(window) == nullptr) {
+            std::cerr << "Window surface could not be created! SDL_Error: " << SDL_GetError() << std::endl;
+            return;
+        }
+        presentStrategy = PRESENT_WINDOW_SURFACE;
+    } else {
+        ensureStreamingTexture(renderer, SCREEN_WIDTH, SCREEN_HEIGHT);
+    }
+    std::cout << "SDL initialized successfully!" << std::endl;
+}
+
+// Set current color
+void setColor(const Color& color) {
+    currentColor = color;
+    currentPixel = color.toUint32();
+}
+
+// Transform model vertices to screen coordinates with the current camera
+std::vector<Vec3> transformVertices(const std::vector<Vec3>& vertices) {
+    StageTimer matrixTimer(STAGE_MATRICES);
+    
+    // Create transformation matrices
+    Mat4 modelMatrix = scale(1.0f, 1.0f, 1.0f);  // Scale the model if needed
+    
+    // Rotate the model for better viewing angle
+    Mat4 rotY = rotationY(cameraAngleY);
+    Mat4 rotX = rotationX(cameraAngleX);
+    Mat4 rotation = rotY * rotX;
+    
+    // Move the model back from the camera
+    Mat4 translationMat = translation(0.0f, 0.0f, -cameraDistance);
+    
+    // Create perspective projection
+    float fov = CAMERA_FOV;
+    float aspect = (float)SCREEN_WIDTH / (float)SCREEN_HEIGHT;
+    Mat4 projection = perspective(fov, aspect, 0.1f, 100.0f);
+    
+    // Combine all transformations
+    Mat4 mvp = projection * translationMat * rotation * modelMatrix;
+    
+    // Transform all vertices
+    StageTimer transformTimer(STAGE_TRANSFORM);
+    CounterScope counters(STAGE_TRANSFORM);
+    std::vector<Vec3> transformedVertices;
+    for (const auto& vertex : vertices) {
+        Vec3 transformed = mvp.multiply(vertex);
+        
+        // Convert from normalized device coordinates to screen coordinates
+        transformed.x = (transformed.x + 1.0f) * 0.5f * SCREEN_WIDTH;
+        transformed.y = (1.0f - transformed.y) * 0.5f * SCREEN_HEIGHT;  // Flip Y axis
+        
+        transformedVertices.push_back(transformed);
+    }
+    
+    return transformedVertices;
+}
+
+// Main render function with 3D transformations.
+// When visibleFaces is given only those face indices are drawn.
+void render(const std::vector<Vec3>& vertices, const std::vector<Face>& faces, const std::vector<int>* visibleFaces = nullptr) {
+    // Clear the screen
+    clear();
+    
+    // Project all vertices to screen space
+    std::vector<Vec3> transformedVertices = transformVertices(vertices);
+    
+    // Draw all triangles
+    StageTimer faceTimer(STAGE_FACES);
+    CounterScope counters(STAGE_RASTER);
+    int triangleCount = 0;
+    size_t faceCount = visibleFaces ? visibleFaces->size() : faces.size();
+    for (size_t i = 0; i < faceCount; i++) {
+        const Face& face = faces[visibleFaces ? (*visibleFaces)[i] : i];
+        if (face.vertexIndices.size() >= 3) {
+            // Check if vertices are valid
+            bool validFace = true;
+            for (const auto& idx : face.vertexIndices) {
+                if (idx[0] >= transformedVertices.size()) {
+                    validFace = false;
+                    break;
+                }
+            }
+            
+            if (!validFace) continue;
+            
+            // Draw first triangle
+            Vec3 v1 = transformedVertices[face.vertexIndices[0][0]];
+            Vec3 v2 = transformedVertices[face.vertexIndices[1][0]];
+            Vec3 v3 = transformedVertices[face.vertexIndices[2][0]];
+            
+            // Simple back-face culling (optional)
+            // Calculate normal using cross product
+            Vec3 edge1 = v2 - v1;
+            Vec3 edge2 = v3 - v1;
+            float normalZ = edge1.x * edge2.y - edge1.y * edge2.x;
+            
+            // Only draw if facing camera (you can comment this out if you want to see all faces)
+            // if (normalZ > 0) {
+                triangle(v1, v2, v3);
+                triangleCount++;
+            // }
+            
+            // If it's a quad, draw the second triangle
+            if (face.vertexIndices.size() == 4) {
+                Vec3 v4 = transformedVertices[face.vertexIndices[3][0]];
+                // if (normalZ > 0) {
+                    triangle(v1, v3, v4);
+                    triangleCount++;
+                // }
+            }
+        }
+    }
+    trianglesDrawn += triangleCount;
+}
+
+// Render the level of detail matching the current camera distance
+void renderLOD(const std::vector<LODLevel>& chain) {
+    static int reportedLevel = -1;
+    int level = lodEnabled ? selectLOD(chain, cameraDistance) : 0;
+    
+    if (level != reportedLevel) {
+        std::cout << "LOD level " << level << " (" << chain[level].triangleCount << " triangles)" << std::endl;
+        reportedLevel = level;
+    }
+    render(chain[level].vertices, chain[level].faces);
+}
+
+// Render the progressive mesh after adapting its cut to the current view
+void renderProgressive(ProgressiveMesh& pm) {
+    {
+        StageTimer timer(STAGE_FACES);
+        float pixelsPerUnit = SCREEN_HEIGHT / (2.0f * tan(CAMERA_FOV / 2.0f));
+        pm.update(cameraPosition(), pixelsPerUnit, lodPixelThreshold, lodHysteresis, progressiveBudget);
+        pm.extract();
+    }
+    render(pm.vertices, pm.faces);
+}
+
+// Render the full-detail mesh restricted to the cached visible set for this view
+void renderVisibleSet(const LODLevel& level, VisibilityCache& cache) {
+    const std::vector<int>* visible;
+    {
+        StageTimer timer(STAGE_FACES);
+        visible = &cache.lookup(cameraPosition(), visibilityNeighbors);
+    }
+    render(level.vertices, level.faces, visible);
+}
+
+// Render the full-detail mesh with incrementally updated back-face culling
+void renderCoherent(const LODLevel& level, CoherentCuller& culler) {
+    const std::vector<int>* visible;
+    {
+        StageTimer timer(STAGE_FACES);
+        visible = &culler.update(cameraPosition());
+    }
+    render(level.vertices, level.faces, visible);
+}
+
+// Draw only silhouette edges and front-facing crease edges of the full-detail mesh.
+// Silhouettes are read off the culler's frontier, creases are precomputed.
+void renderEdgePreview(const LODLevel& level, const MeshAdjacency& adjacency, CoherentCuller& culler) {
+    clear();
+    {
+        StageTimer timer(STAGE_FACES);
+        culler.update(cameraPosition());
+    }
+    std::vector<Vec3> transformedVertices = transformVertices(level.vertices);
+    StageTimer edgeTimer(STAGE_FACES);
+    CounterScope counters(STAGE_RASTER);
+    const std::vector<uint8_t>& front = culler.front;
+    size_t lines = 0;
+    
+    for (int f : culler.frontier) {
+        if (!front[f]) continue;
+        for (int e : adjacency.faceEdges[f]) {
+            const MeshEdge& edge = adjacency.edges[e];
+            int other = (edge.face0 == f) ? edge.face1 : edge.face0;
+            if (other < 0 || front[other]) continue;  // Open borders are drawn below
+            line(transformedVertices[edge.v0], transformedVertices[edge.v1]);
+            lines++;
+        }
+    }
+    
+    // Open boundaries of front faces are outlines too
+    for (int e : adjacency.boundaryEdges) {
+        const MeshEdge& edge = adjacency.edges[e];
+        if (!front[edge.face0]) continue;
+        line(transformedVertices[edge.v0], transformedVertices[edge.v1]);
+        lines++;
+    }
+    
+    for (int e : adjacency.creaseEdges) {
+        const MeshEdge& edge = adjacency.edges[e];
+        // Skip silhouettes already drawn and creases hidden on the back
+        if (!front[edge.face0] || !front[edge.face1]) continue;
+        line(transformedVertices[edge.v0], transformedVertices[edge.v1]);
+        lines++;
+    }
+    
+    edgePreviewLines = lines;
+}
+
+// Lock-free single-producer, single-consumer triple buffer. The writer fills one
+// slot while the reader holds another; the third is handed over through middle.
+template <typename T>
+struct TripleBuffer {
+    static const int FRESH = 4;  // Set in middle while it holds a slot the reader has not taken
+    
+    T slots[3];
+    SDL_atomic_t middle;
+    int back;   // Writer's slot
+    int front;  // Reader's slot
+    
+    TripleBuffer() {
+        reset();
+    }
+    
+    // Only call while neither side is running
+    void reset() {
+        back = 0;
+        front = 1;
+        SDL_AtomicSet(&middle, 2);
+    }
+    
+    T& writeSlot() {
+        return slots[back];
+    }
+    
+    T& readSlot() {
+        return slots[front];
+    }
+    
+    // Hand the written slot to the reader and take the spare one
+    void publish() {
+        SDL_MemoryBarrierRelease();
+        back = SDL_AtomicSet(&middle, back | FRESH) & 3;
+        SDL_MemoryBarrierAcquire();
+    }
+    
+    // Take the newest published slot; false when nothing new arrived
+    bool update() {
+        if (!(SDL_AtomicGet(&middle) & FRESH)) return false;
+        SDL_MemoryBarrierRelease();
+        front = SDL_AtomicSet(&middle, front) & 3;
+        SDL_MemoryBarrierAcquire();
+        return true;
+    }
+};
+
+// Rolling per-stage history of the last frames, in milliseconds
+struct FrameProfile {
+    static const int HISTORY = 120;
+    
+    float ms[HISTORY][STAGE_COUNT + 1];  // The last column is the frame total
+    uint64_t counters[HISTORY][3][COUNTER_COUNT];  // For COUNTED_STAGES
+    int next;
+    int count;
+    
+    FrameProfile() : next(0), count(0) {}
+    
+    void record(const float* stageMs, const uint64_t (*stageCounts)[COUNTER_COUNT]) {
+        float total = 0.0f;
+        for (int s = 0; s < STAGE_COUNT; s++) {
+            ms[next][s] = stageMs[s];
+            total += stageMs[s];
+        }
+        ms[next][STAGE_COUNT] = total;
+        for (int i = 0; i < 3; i++) {
+            memcpy(counters[next][i], stageCounts[COUNTED_STAGES[i]], sizeof(counters[next][i]));
+        }
+        next = (next + 1) % HISTORY;
+        if (count < HISTORY) count++;
+    }
+    
+    // Mean per frame of one counter of a counted stage
+    double meanCounter(int countedStage, int counter) const {
+        double sum = 0.0;
+        for (int i = 0; i < count; i++) sum += static_cast<double>(counters[i][countedStage][counter]);
+        return sum / count;
+    }
+    
+    // Mean and nearest-rank percentiles of one column over the history
+    void summarize(int column, float& mean, float& p50, float& p95, float& p99) const {
+        float sorted[HISTORY];
+        float sum = 0.0f;
+        for (int i = 0; i < count; i++) {
+            sorted[i] = ms[i][column];
+            sum += sorted[i];
+        }
+        std::sort(sorted, sorted + count);
+        mean = sum / count;
+        p50 = sorted[std::max(0, static_cast<int>(std::ceil(0.50f * count)) - 1)];
+        p95 = sorted[std::max(0, static_cast<int>(std::ceil(0.95f * count)) - 1)];
+        p99 = sorted[std::max(0, static_cast<int>(std::ceil(0.99f * count)) - 1)];
+    }
+};
+
+// What the HUD shows, built by the profiler after each presented frame
+struct HudFrame {
+    std::vector<std::string> lines;  // Header, one row per stage, the total, then hardware counters
+    float share[STAGE_COUNT];        // Each stage's part of the average frame
+};
+
+SDL_atomic_t hudEnabled;
+FrameProfile frameProfile;
+TripleBuffer<HudFrame> hudQueue;  // Profiler (main thread) to whichever thread draws the frame
+std::ofstream profileCsv;         // Open when --profile-csv was given
+size_t profiledFrames = 0;
+
+const int HUD_SCALE = 2;          // Screen pixels per font pixel
+const int HUD_BAR_WIDTH = 100;    // Bar length of a stage taking the whole frame
+const uint32_t HUD_PIXEL = 0xFF00FF00;
+
+// 3x5 font, one bit per pixel from the top-left, 15 bits per glyph
+uint16_t glyphBits(char c) {
+    static const uint16_t digits[10] = {0x7B6F, 0x2C97, 0x73E7, 0x73CF, 0x5BC9, 0x79CF, 0x79EF, 0x7249, 0x7BEF, 0x7BCF};
+    static const uint16_t letters[26] = {0x2BED, 0x6BAE, 0x3923, 0x6B6E, 0x79A7, 0x79A4, 0x396B, 0x5BED, 0x7497, 0x126A, 0x5BAD, 0x4927, 0x5FED,
+                                         0x6B6D, 0x2B6A, 0x6BA4, 0x2B73, 0x6BAD, 0x388E, 0x7492, 0x5B6F, 0x5B6A, 0x5BFD, 0x5AAD, 0x5A92, 0x72A7};
+    if (c >= '0' && c <= '9') return digits[c - '0'];
+    if (c >= 'A' && c <= 'Z') return letters[c - 'A'];
+    if (c >= 'a' && c <= 'z') return letters[c - 'a'];
+    switch (c) {
+        case '.': return 0x0002;
+        case ':': return 0x0410;
+        case '/': return 0x12A4;
+        case '-': return 0x01C0;
+        case '%': return 0x52A5;
+        default: return 0;
+    }
+}
+
+// Fill a rectangle with the current color
+void fillRect(int x, int y, int width, int height) {
+    for (int py = y; py < y + height; py++) {
+        for (int px = x; px < x + width; px++) pixel(px, py);
+    }
+}
+
+void drawText(int x, int y, const std::string& text) {
+    for (size_t i = 0; i < text.size(); i++) {
+        uint16_t bits = glyphBits(text[i]);
+        int left = x + static_cast<int>(i) * 4 * HUD_SCALE;
+        for (int bit = 0; bit < 15; bit++) {
+            if (bits & (0x4000 >> bit)) fillRect(left + (bit % 3) * HUD_SCALE, y + (bit / 3) * HUD_SCALE, HUD_SCALE, HUD_SCALE);
+        }
+    }
+}
+
+// Draw the newest profiler summary over the top-left corner of the frame
+void drawHUD() {
+    hudQueue.update();
+    const HudFrame& hud = hudQueue.readSlot();
+    if (hud.lines.empty()) return;
+    
+    const int margin = 8;
+    const int lineHeight = 6 * HUD_SCALE;
+    const size_t tableRows = STAGE_COUNT + 2;
+    size_t columns = 0;
+    size_t widest = 0;
+    for (size_t i = 0; i < hud.lines.size(); i++) {
+        if (i < tableRows) columns = std::max(columns, hud.lines[i].size());
+        widest = std::max(widest, hud.lines[i].size());
+    }
+    int barX = margin + static_cast<int>(columns + 1) * 4 * HUD_SCALE;
+    int right = std::max(barX + HUD_BAR_WIDTH, margin + static_cast<int>(widest) * 4 * HUD_SCALE);
+    markDirty(margin, margin, right, margin + static_cast<int>(hud.lines.size()) * lineHeight);
+    
+    uint32_t savedPixel = currentPixel;
+    currentPixel = HUD_PIXEL;
+    for (size_t i = 0; i < hud.lines.size(); i++) {
+        drawText(margin, margin + static_cast<int>(i) * lineHeight, hud.lines[i]);
+    }
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        int width = static_cast<int>(hud.share[s] * HUD_BAR_WIDTH + 0.5f);
+        fillRect(barX, margin + (s + 1) * lineHeight, width, 5 * HUD_SCALE);
+    }
+    currentPixel = savedPixel;
+}
+
+// Short form of a large count for the HUD
+std::string formatCount(double count) {
+    char text[16];
+    if (count >= 1e9) snprintf(text, sizeof(text), "%.1fG", count / 1e9);
+    else if (count >= 1e6) snprintf(text, sizeof(text), "%.1fM", count / 1e6);
+    else if (count >= 1e3) snprintf(text, sizeof(text), "%.1fK", count / 1e3);
+    else snprintf(text, sizeof(text), "%.0f", count);
+    return text;
+}
+
+// Close the profile of a presented frame: record its stage times, stream them to
+// the CSV and hand a new summary to the HUD. renderTicks and renderCounters carry
+// the render stages when the frame was drawn on the render thread.
+void finishProfiledFrame(const Uint64* renderTicks, const uint64_t (*renderCounters)[COUNTER_COUNT]) {
+    if (!SDL_AtomicGet(&profilerEnabled)) return;
+    
+    double ticksToMs = 1000.0 / SDL_GetPerformanceFrequency();
+    float ms[STAGE_COUNT];
+    uint64_t counts[STAGE_COUNT][COUNTER_COUNT];
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        bool fromRenderThread = renderTicks && s < FIRST_PRESENT_STAGE;
+        ms[s] = static_cast<float>((fromRenderThread ? renderTicks[s] : stageTicks[s]) * ticksToMs);
+        memcpy(counts[s], fromRenderThread ? renderCounters[s] : stageCounters[s], sizeof(counts[s]));
+        if (!fromRenderThread) {
+            stageTicks[s] = 0;
+            memset(stageCounters[s], 0, sizeof(stageCounters[s]));
+        }
+    }
+    frameProfile.record(ms, counts);
+    profiledFrames++;
+    
+    if (profileCsv.is_open()) {
+        float total = 0.0f;
+        profileCsv << profiledFrames;
+        for (int s = 0; s < STAGE_COUNT; s++) {
+            profileCsv << ',' << ms[s];
+            total += ms[s];
+        }
+        profileCsv << ',' << total;
+        if (perfCountersEnabled) {
+            for (int i = 0; i < 3; i++) {
+                for (int c = 0; c < COUNTER_COUNT; c++) profileCsv << ',' << counts[COUNTED_STAGES[i]][c];
+            }
+        }
+        profileCsv << '\n';
+    }
+    
+    if (!SDL_AtomicGet(&hudEnabled)) return;
+    HudFrame& hud = hudQueue.writeSlot();
+    hud.lines.clear();
+    char row[64];
+    snprintf(row, sizeof(row), "%-9s %6s %6s %6s %6s", "MS", "AVG", "P50", "P95", "P99");
+    hud.lines.push_back(row);
+    float mean, p50, p95, p99;
+    frameProfile.summarize(STAGE_COUNT, mean, p50, p95, p99);
+    float totalMean = mean;
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        frameProfile.summarize(s, mean, p50, p95, p99);
+        snprintf(row, sizeof(row), "%-9s %6.2f %6.2f %6.2f %6.2f", STAGE_NAMES[s], mean, p50, p95, p99);
+        hud.lines.push_back(row);
+        hud.share[s] = totalMean > 0.0f ? mean / totalMean : 0.0f;
+    }
+    frameProfile.summarize(STAGE_COUNT, mean, p50, p95, p99);
+    snprintf(row, sizeof(row), "%-9s %6.2f %6.2f %6.2f %6.2f", "total", mean, p50, p95, p99);
+    hud.lines.push_back(row);
+    
+    // Per-frame averages of the hardware counters
+    if (perfCountersEnabled) {
+        for (int i = 0; i < 3; i++) {
+            double cycles = frameProfile.meanCounter(i, COUNTER_CYCLES);
+            double ipc = cycles > 0.0 ? frameProfile.meanCounter(i, COUNTER_INSTRUCTIONS) / cycles : 0.0;
+            snprintf(row, sizeof(row), "%-9s IPC %4.2f L1 %s LLC %s BR %s", STAGE_NAMES[COUNTED_STAGES[i]], ipc,
+                     formatCount(frameProfile.meanCounter(i, COUNTER_L1D_MISSES)).c_str(),
+                     formatCount(frameProfile.meanCounter(i, COUNTER_LLC_MISSES)).c_str(),
+                     formatCount(frameProfile.meanCounter(i, COUNTER_BRANCH_MISSES)).c_str());
+            hud.lines.push_back(row);
+        }
+    }
+    hudQueue.publish();
+}
+
+// Render the loaded model with the selected detail strategy
+void renderScene() {
+    TraceZone zone("renderScene");
+    stageProfiling[0] = SDL_AtomicGet(&profilerEnabled) != 0;
+    beginFrame(renderer);
+    if (edgePreviewEnabled) {
+        renderEdgePreview(lodChain[0], meshAdjacency, coherentCuller);
+    } else if (progressiveEnabled) {
+        renderProgressive(progressiveMesh);
+    } else if (coherentCullingEnabled) {
+        renderCoherent(lodChain[0], coherentCuller);
+    } else if (visibilityCacheEnabled && !visibilityCache.empty()) {
+        renderVisibleSet(lodChain[0], visibilityCache);
+    } else {
+        renderLOD(lodChain);
+    }
+    if (SDL_AtomicGet(&hudEnabled)) drawHUD();
+}
+
+// Frame produced by the render thread
+struct RenderedFrame {
+    std::vector<uint32_t> pixels;
+    bool cleared;         // Presenting already wrote the background back
+    DirtyRect drawn;      // Pixels the last frame in this slot drew, for dirty rectangle clears
+    Uint64 inputCounter;  // Copied from the camera it was rendered with
+    double renderMs;      // Rasterization time, for dynamic resolution
+    Uint64 stageTicks[FIRST_PRESENT_STAGE];  // Profiled render stages of this frame
+    uint64_t stageCounters[FIRST_PRESENT_STAGE][COUNTER_COUNT];
+};
+
+// Render thread: rasterizes frame N while the main thread presents frame N-1.
+// Only camera changes cross threads; other settings pause the thread while they change.
+bool threadedEnabled = false;
+SDL_Thread* renderThread = nullptr;
+SDL_atomic_t renderThreadRunning;
+TripleBuffer<CameraState> cameraQueue;   // Main thread to render thread
+TripleBuffer<RenderedFrame> frameQueue;  // Render thread to main thread
+Uint32 frameReadyEvent = 0;              // Pushed after each frame so an idle main loop wakes up
+
+int renderThreadMain(void*) {
+    setTraceThread("render");
+    while (SDL_AtomicGet(&renderThreadRunning)) {
+        if (!cameraQueue.update()) {
+            SDL_Delay(1);
+            continue;
+        }
+        const CameraState& camera = cameraQueue.readSlot();
+        applyCamera(camera);
+        
+        // Draw into the slot through the usual framebuffer globals
+        RenderedFrame& frame = frameQueue.writeSlot();
+        framebuffer.swap(frame.pixels);
+        drawTarget.pixels = framebuffer.data();
+        framebufferPreCleared = frame.cleared;
+        
+        // Each slot still holds its own older frame, so only that frame's pixels need clearing
+        previousDirty = frame.cleared ? DirtyRect() : frame.drawn;
+        frameDirty = DirtyRect();
+        dirtyHistoryValid = true;
+        Uint64 start = SDL_GetPerformanceCounter();
+        renderScene();
+        frame.renderMs = (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+        framebuffer.swap(frame.pixels);
+        frame.drawn = frameDirty;
+        for (int s = 0; s < FIRST_PRESENT_STAGE; s++) {
+            frame.stageTicks[s] = stageTicks[s];
+            stageTicks[s] = 0;
+            memcpy(frame.stageCounters[s], stageCounters[s], sizeof(frame.stageCounters[s]));
+            memset(stageCounters[s], 0, sizeof(stageCounters[s]));
+        }
+        
+        frame.cleared = false;
+        frame.inputCounter = camera.inputCounter;
+        frameQueue.publish();
+        
+        if (frameReadyEvent != static_cast<Uint32>(-1)) {
+            SDL_Event ready = {};
+            ready.type = frameReadyEvent;
+            SDL_PushEvent(&ready);
+        }
+    }
+    closeThreadCounters();
+    return 0;
+}
+
+// The render thread draws plain linear frames that are presented through the streaming texture
+bool canRenderThreaded() {
+    return renderer != nullptr && presentStrategy != PRESENT_WINDOW_SURFACE && !monochromeEnabled && !tiledEnabled;
+}
+
+bool startRenderThread() {
+    if (renderThread) return true;
+    if (!canRenderThreaded()) return false;
+    
+    for (int i = 0; i < 3; i++) {
+        frameQueue.slots[i].pixels.assign(framebuffer.size(), BACKGROUND_PIXEL);
+        frameQueue.slots[i].cleared = true;
+        frameQueue.slots[i].drawn = DirtyRect();
+    }
+    frameQueue.reset();
+    cameraQueue.reset();
+    if (frameReadyEvent == 0) frameReadyEvent = SDL_RegisterEvents(1);
+    
+    SDL_AtomicSet(&renderThreadRunning, 1);
+    renderThread = SDL_CreateThread(renderThreadMain, "render", nullptr);
+    if (renderThread == nullptr) {
+        std::cerr << "Render thread could not be created! SDL_Error: " << SDL_GetError() << std::endl;
+        SDL_AtomicSet(&renderThreadRunning, 0);
+        return false;
+    }
+    return true;
+}
+
+void stopRenderThread() {
+    if (!renderThread) return;
+    SDL_AtomicSet(&renderThreadRunning, 0);
+    SDL_WaitThread(renderThread, nullptr);
+    renderThread = nullptr;
+    
+    drawTarget.pixels = framebuffer.data();
+    framebufferPreCleared = false;
+    dirtyHistoryValid = false;
+}
+
+// Upload and present the newest frame from the render thread, if one arrived
+const RenderedFrame* presentRenderedFrame(SDL_Renderer* renderer) {
+    if (!frameQueue.update()) return nullptr;
+    TraceZone zone("presentRenderedFrame");
+    stageProfiling[1] = SDL_AtomicGet(&profilerEnabled) != 0;
+    RenderedFrame& frame = frameQueue.readSlot();
+    if (!ensureStreamingTexture(renderer, SCREEN_WIDTH, SCREEN_HEIGHT)) return nullptr;
+    
+    void* texturePixels;
+    int texturePitch;
+    StageTimer uploadTimer(STAGE_UPLOAD);
+    CounterScope counters(STAGE_UPLOAD);
+    if (SDL_LockTexture(streamingTexture, nullptr, &texturePixels, &texturePitch) == 0) {
+        PixelView view = {static_cast<uint32_t*>(texturePixels), SCREEN_WIDTH, SCREEN_HEIGHT,
+                          texturePitch / static_cast<int>(sizeof(uint32_t))};
+        if (fusedClearEnabled) {
+            // The slot goes back to the render thread already cleared
+            copyAndClear(view, frame.pixels.data(), SCREEN_WIDTH);
+            frame.cleared = true;
+        } else {
+            for (int y = 0; y < SCREEN_HEIGHT; y++) {
+                memcpy(view.row(y), &frame.pixels[static_cast<size_t>(y) * SCREEN_WIDTH], SCREEN_WIDTH * sizeof(uint32_t));
+            }
+        }
+        SDL_UnlockTexture(streamingTexture);
+    }
+    counters.stop();
+    presentTexture(renderer, streamingTexture);
+    return &frame;
+}
+
+// Apply a new window size or render scale, pausing the render thread around it
+void resizeRender() {
+    bool threaded = renderThread != nullptr;
+    stopRenderThread();
+    size_t allocations = framebufferAllocations;
+    setRenderResolution();
+    std::cout << "Render resolution " << SCREEN_WIDTH << "x" << SCREEN_HEIGHT << " (scale " << renderScale << ")"
+              << (framebufferAllocations != allocations ? ", framebuffer grown" : "") << std::endl;
+    if (threaded) startRenderThread();
+}
+
+size_t frameRequests = 0;  // Frames rendered or handed to the render thread
+
+// Show the scene from a camera: rendered right here, or handed to the render thread
+void requestFrame(CameraState camera) {
+    frameRequests++;
+    if (renderThread) {
+        camera.inputCounter = SDL_GetPerformanceCounter();
+        cameraQueue.writeSlot() = camera;
+        cameraQueue.publish();
+    } else {
+        Uint64 start = SDL_GetPerformanceCounter();
+        applyCamera(camera);
+        renderScene();
+        renderBuffer(renderer);
+        finishProfiledFrame(nullptr, nullptr);
+        if (updateRenderScale((SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency())) {
+            resizeRender();
+        }
+    }
+}
+
+// Print render() time against camera distance with and without LOD selection
+void runLODBenchmark(const std::vector<LODLevel>& chain, int framesPerStep = 50) {
+    float savedDistance = cameraDistance;
+    double ticksToMs = 1000.0 / SDL_GetPerformanceFrequency();
+    
+    std::cout << "\n=== LOD Benchmark (" << framesPerStep << " frames per step) ===" << std::endl;
+    std::cout << "distance  level  triangles  full_ms  lod_ms" << std::endl;
+    
+    for (int step = 0; step <= 18; step++) {
+        cameraDistance = 1.0f + step * 0.5f;
+        currentLOD = 0;
+        int level = selectLOD(chain, cameraDistance);
+        
+        Uint64 start = SDL_GetPerformanceCounter();
+        for (int i = 0; i < framesPerStep; i++) render(chain[0].vertices, chain[0].faces);
+        double fullMs = (SDL_GetPerformanceCounter() - start) * ticksToMs / framesPerStep;
+        
+        start = SDL_GetPerformanceCounter();
+        for (int i = 0; i < framesPerStep; i++) render(chain[level].vertices, chain[level].faces);
+        double lodMs = (SDL_GetPerformanceCounter() - start) * ticksToMs / framesPerStep;
+        
+        char row[96];
+        snprintf(row, sizeof(row), "%8.1f  %5d  %9zu  %7.3f  %6.3f", cameraDistance, level, chain[level].triangleCount, fullMs, lodMs);
+        std::cout << row << std::endl;
+    }
+    std::cout << "================================\n" << std::endl;
+    
+    cameraDistance = savedDistance;
+    currentLOD = 0;
+}
+
+// Benchmarks store results here so the measured work is not optimized away
+volatile uint32_t benchmarkSink = 0;
+
+// Compare the old per-pixel RGBA to ARGB conversion with a packed copy
+void runPixelBenchmark(int iterations = 50) {
+    const int sizes[2][2] = {{800, 600}, {3840, 2160}};
+    double ticksToMs = 1000.0 / SDL_GetPerformanceFrequency();
+    
+    std::cout << "\n=== Pixel Upload Benchmark (" << iterations << " iterations) ===" << std::endl;
+    std::cout << "resolution  convert_ms  memcpy_ms  saved_ms  clear+copy_ms  fused_ms  fused_GB/s" << std::endl;
+    
+    for (int i = 0; i < 2; i++) {
+        size_t count = static_cast<size_t>(sizes[i][0]) * sizes[i][1];
+        std::vector<Color> colors(count, Color(255, 255, 0));
+        std::vector<uint32_t> packed(count, Color(255, 255, 0).toUint32());
+        std::vector<uint32_t> texture(count);
+        uint32_t checksum = 0;
+        
+        Uint64 start = SDL_GetPerformanceCounter();
+        for (int it = 0; it < iterations; it++) {
+            colors[it % count].b = static_cast<uint8_t>(it);
+            for (size_t p = 0; p < count; p++) texture[p] = colors[p].toUint32();
+            checksum += texture[it % count];
+        }
+        double convertMs = (SDL_GetPerformanceCounter() - start) * ticksToMs / iterations;
+        
+        start = SDL_GetPerformanceCounter();
+        for (int it = 0; it < iterations; it++) {
+            packed[it % count] = static_cast<uint32_t>(it);
+            memcpy(texture.data(), packed.data(), count * sizeof(uint32_t));
+            checksum += texture[it % count];
+        }
+        double copyMs = (SDL_GetPerformanceCounter() - start) * ticksToMs / iterations;
+        
+        // Separate clear and upload passes against the fused non-temporal pass
+        start = SDL_GetPerformanceCounter();
+        for (int it = 0; it < iterations; it++) {
+            packed[it % count] = static_cast<uint32_t>(it);
+            memcpy(texture.data(), packed.data(), count * sizeof(uint32_t));
+            std::fill(packed.begin(), packed.end(), BACKGROUND_PIXEL);
+            checksum += texture[it % count];
+        }
+        double separateMs = (SDL_GetPerformanceCounter() - start) * ticksToMs / iterations;
+        
+        PixelView view = {texture.data(), sizes[i][0], sizes[i][1], sizes[i][0]};
+        start = SDL_GetPerformanceCounter();
+        for (int it = 0; it < iterations; it++) {
+            packed[it % count] = static_cast<uint32_t>(it);
+            copyAndClear(view, packed.data(), sizes[i][0]);
+            checksum += texture[it % count];
+        }
+        double fusedMs = (SDL_GetPerformanceCounter() - start) * ticksToMs / iterations;
+        // One read and two writes of the frame per pass
+        double fusedGBs = 3.0 * count * sizeof(uint32_t) / (fusedMs * 1e6);
+        
+        char row[128];
+        snprintf(row, sizeof(row), "%4dx%-6d  %10.3f  %9.3f  %8.3f  %13.3f  %8.3f  %10.2f", sizes[i][0], sizes[i][1],
+                 convertMs, copyMs, convertMs - copyMs, separateMs, fusedMs, fusedGBs);
+        std::cout << row << std::endl;
+        benchmarkSink = checksum;
+    }
+    std::cout << "================================\n" << std::endl;
+}
+
+// Small deterministic generator (xorshift32) so benchmarks and generated meshes repeat exactly
+struct Random {
+    uint32_t state;
+    
+    explicit Random(uint32_t seed) : state(seed ? seed : 1) {}
+    
+    uint32_t next() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+    
+    float uniform(float lo, float hi) {
+        return lo + (hi - lo) * (next() >> 8) * (1.0f / 16777216.0f);
+    }
+};
+
+// An n x n grid of quads as OBJ text, a stand-in for large production meshes
+std::string gridOBJ(int n) {
+    std::string out;
+    char row[96];
+    for (int y = 0; y <= n; y++) {
+        for (int x = 0; x <= n; x++) {
+            float fx = 2.0f * x / n - 1.0f;
+            float fy = 2.0f * y / n - 1.0f;
+            snprintf(row, sizeof(row), "v %.6f %.6f %.6f\n", fx, fy, 0.1f * sin(6.0f * fx) * cos(6.0f * fy));
+            out += row;
+        }
+    }
+    for (int y = 0; y < n; y++) {
+        for (int x = 0; x < n; x++) {
+            int i = y * (n + 1) + x + 1;  // OBJ indices start at 1
+            snprintf(row, sizeof(row), "f %d %d %d %d\n", i, i + 1, i + n + 2, i + n + 1);
+            out += row;
+        }
+    }
+    return out;
+}
+
+// Writes OBJ text through one large buffer, so generated meshes far bigger than
+// memory are streamed to disk and never exist in full
+struct OBJWriter {
+    FILE* file;
+    std::vector<char> buffer;
+    size_t used;
+    long long vertices;  // Written so far; the next vertex has OBJ index vertices + 1
+    long long faces;
+    
+    OBJWriter() : file(nullptr), buffer(1 << 20), used(0), vertices(0), faces(0) {}
+    
+    bool open(const std::string& path) {
+        file = fopen(path.c_str(), "wb");
+        return file != nullptr;
+    }
+    
+    void flush() {
+        if (used) fwrite(buffer.data(), 1, used, file);
+        used = 0;
+    }
+    
+    void vertex(float x, float y, float z) {
+        if (used + 64 > buffer.size()) flush();
+        used += snprintf(&buffer[used], 64, "v %.6f %.6f %.6f\n", x, y, z);
+        vertices++;
+    }
+    
+    // Face over 1-based vertex indices
+    void face(const long long* indices, int count) {
+        if (used + 8 + count * 21 > buffer.size()) flush();
+        buffer[used++] = 'f';
+        for (int i = 0; i < count; i++) used += snprintf(&buffer[used], 22, " %lld", indices[i]);
+        buffer[used++] = '\n';
+        faces++;
+    }
+    
+    bool close() {
+        flush();
+        bool ok = !ferror(file);
+        return fclose(file) == 0 && ok;
+    }
+};
+
+// UV sphere of radius 1 with about targetFaces triangles: quads split in two
+// between the poles and triangle fans at them
+void generateSphere(OBJWriter& out, long long targetFaces) {
+    const float PI = 3.14159265f;
+    long long rings = std::max(3LL, static_cast<long long>(std::ceil(std::sqrt(targetFaces / 4.0))));
+    long long segments = 2 * rings;
+    
+    out.vertex(0.0f, 1.0f, 0.0f);
+    for (long long r = 1; r < rings; r++) {
+        float polar = PI * r / rings;
+        for (long long s = 0; s < segments; s++) {
+            float azimuth = 2.0f * PI * s / segments;
+            out.vertex(sin(polar) * cos(azimuth), cos(polar), sin(polar) * sin(azimuth));
+        }
+    }
+    out.vertex(0.0f, -1.0f, 0.0f);
+    
+    // Ring r (1-based) starts at vertex 2 + (r - 1) * segments
+    long long south = 2 + (rings - 1) * segments;
+    for (long long s = 0; s < segments; s++) {
+        long long next = (s + 1) % segments;
+        long long cap[3] = {1, 2 + next, 2 + s};
+        out.face(cap, 3);
+        for (long long r = 1; r + 1 < rings; r++) {
+            long long a = 2 + (r - 1) * segments + s, b = 2 + (r - 1) * segments + next;
+            long long c = b + segments, d = a + segments;
+            long long first[3] = {a, b, c};
+            long long second[3] = {a, c, d};
+            out.face(first, 3);
+            out.face(second, 3);
+        }
+        long long bottom[3] = {south, 2 + (rings - 2) * segments + s, 2 + (rings - 2) * segments + next};
+        out.face(bottom, 3);
+    }
+}
+
+// Copies of a model on a cubic grid scaled into [-1, 1], about targetFaces faces in all
+bool generateTiledModel(OBJWriter& out, long long targetFaces, const std::string& modelPath) {
+    std::vector<Vec3> vertices;
+    std::vector<Face> faces;
+    if (!loadOBJ(modelPath, vertices, faces) || vertices.empty() || faces.empty()) {
+        std::cerr << "Could not tile " << modelPath << ": no faces loaded" << std::endl;
+        return false;
+    }
+    
+    Vec3 low = vertices[0], high = vertices[0];
+    for (const auto& v : vertices) {
+        low = Vec3(std::min(low.x, v.x), std::min(low.y, v.y), std::min(low.z, v.z));
+        high = Vec3(std::max(high.x, v.x), std::max(high.y, v.y), std::max(high.z, v.z));
+    }
+    float extent = std::max(high.x - low.x, std::max(high.y - low.y, high.z - low.z));
+    if (extent <= 0.0f) extent = 1.0f;
+    
+    long long copies = std::max(1LL, (targetFaces + static_cast<long long>(faces.size()) - 1) / static_cast<long long>(faces.size()));
+    long long perSide = static_cast<long long>(std::ceil(std::cbrt(static_cast<double>(copies))));
+    float cell = 2.0f / perSide;
+    float scale = 0.9f * cell / extent;  // A small gap between copies
+    std::vector<long long> indices;
+    
+    for (long long copy = 0; copy < copies; copy++) {
+        float ox = -1.0f + cell * (copy % perSide + 0.05f);
+        float oy = -1.0f + cell * (copy / perSide % perSide + 0.05f);
+        float oz = -1.0f + cell * (copy / (perSide * perSide) + 0.05f);
+        long long base = out.vertices;
+        for (const auto& v : vertices) {
+            out.vertex(ox + (v.x - low.x) * scale, oy + (v.y - low.y) * scale, oz + (v.z - low.z) * scale);
+        }
+        for (const auto& face : faces) {
+            indices.clear();
+            for (const auto& idx : face.vertexIndices) indices.push_back(base + idx[0] + 1);
+            out.face(indices.data(), static_cast<int>(indices.size()));
+        }
+    }
+    return true;
+}
+
+// Unconnected random triangles in [-1, 1], each written right after its vertices
+void generateSoup(OBJWriter& out, long long targetFaces, Random& random) {
+    float size = 4.0f / static_cast<float>(std::cbrt(static_cast<double>(targetFaces)));
+    for (long long t = 0; t < targetFaces; t++) {
+        float cx = random.uniform(-1.0f, 1.0f), cy = random.uniform(-1.0f, 1.0f), cz = random.uniform(-1.0f, 1.0f);
+        long long indices[3];
+        for (int i = 0; i < 3; i++) {
+            out.vertex(cx + random.uniform(-size, size), cy + random.uniform(-size, size), cz + random.uniform(-size, size));
+            indices[i] = out.vertices;
+        }
+        out.face(indices, 3);
+    }
+}
+
+// Regular polygons of 5 to 12 sides on a grid in the z = 0 plane
+void generateNgons(OBJWriter& out, long long targetFaces, Random& random) {
+    long long perSide = std::max(1LL, static_cast<long long>(std::ceil(std::sqrt(static_cast<double>(targetFaces)))));
+    float cell = 2.0f / perSide;
+    long long indices[12];
+    for (long long f = 0; f < targetFaces; f++) {
+        int sides = 5 + static_cast<int>(random.next() % 8);
+        float cx = -1.0f + cell * (f % perSide + 0.5f);
+        float cy = -1.0f + cell * (f / perSide + 0.5f);
+        float phase = random.uniform(0.0f, 6.28318f);
+        for (int i = 0; i < sides; i++) {
+            float angle = phase + 6.28318f * i / sides;
+            out.vertex(cx + 0.45f * cell * cos(angle), cy + 0.45f * cell * sin(angle), 0.0f);
+            indices[i] = out.vertices;
+        }
+        out.face(indices, sides);
+    }
+}
+
+// Write a synthetic OBJ of about targetFaces faces for load and render scaling tests
+bool generateMesh(const std::string& kind, long long targetFaces, const std::string& path, const std::string& modelPath) {
+    OBJWriter out;
+    if (!out.open(path)) {
+        std::cerr << "Could not create " << path << std::endl;
+        return false;
+    }
+    Random random(2024);
+    Uint64 start = SDL_GetPerformanceCounter();
+    bool generated = true;
+    
+    if (kind == "sphere") {
+        generateSphere(out, targetFaces);
+    } else if (kind == "tiled") {
+        generated = generateTiledModel(out, targetFaces, modelPath);
+    } else if (kind == "soup") {
+        generateSoup(out, targetFaces, random);
+    } else if (kind == "ngon") {
+        generateNgons(out, targetFaces, random);
+    } else {
+        std::cerr << "Unknown mesh kind " << kind << " (sphere, tiled, soup or ngon)" << std::endl;
+        generated = false;
+    }
+    
+    bool written = out.close();
+    if (!generated || !written) {
+        if (generated) std::cerr << "Could not write " << path << std::endl;
+        std::remove(path.c_str());  // Leave no empty or partial OBJ behind
+        return false;
+    }
+    double seconds = (SDL_GetPerformanceCounter() - start) / static_cast<double>(SDL_GetPerformanceFrequency());
+    std::cout << "Wrote " << out.vertices << " vertices and " << out.faces << " faces to " << path
+              << " in " << seconds << " s" << std::endl;
+    return true;
+}
+
+// Time a kernel as nanoseconds per operation: one warm-up batch, then the median
+// and best of five timed batches of `operations` calls to kernel(i)
+template <typename Kernel>
+void timeKernel(const char* name, int operations, Kernel kernel) {
+    const int batches = 5;
+    double ticksToNs = 1e9 / SDL_GetPerformanceFrequency();
+    double nsPerOp[batches];
+    
+    for (int i = 0; i < operations; i++) kernel(i);
+    for (int b = 0; b < batches; b++) {
+        Uint64 start = SDL_GetPerformanceCounter();
+        for (int i = 0; i < operations; i++) kernel(i);
+        nsPerOp[b] = (SDL_GetPerformanceCounter() - start) * ticksToNs / operations;
+    }
+    std::sort(nsPerOp, nsPerOp + batches);
+    
+    char row[128];
+    snprintf(row, sizeof(row), "%-24s %9d  %14.1f  %12.1f", name, operations, nsPerOp[batches / 2], nsPerOp[0]);
+    std::cout << row << std::endl;
+}
+
+// Line segments of one length range at random positions and directions, kept on screen
+std::vector<std::pair<Vec3, Vec3>> randomSegments(Random& random, float minLength, float maxLength, bool steep) {
+    std::vector<std::pair<Vec3, Vec3>> segments(4096);
+    for (auto& segment : segments) {
+        float length = random.uniform(minLength, maxLength);
+        float angle = steep ? random.uniform(1.45f, 1.69f) : random.uniform(0.0f, 6.28318f);
+        float dx = length * cos(angle);
+        float dy = length * sin(angle);
+        float x = random.uniform(std::max(0.0f, -dx), std::min(static_cast<float>(SCREEN_WIDTH - 1), SCREEN_WIDTH - 1 - dx));
+        float y = random.uniform(std::max(0.0f, -dy), std::min(static_cast<float>(SCREEN_HEIGHT - 1), SCREEN_HEIGHT - 1 - dy));
+        segment = std::make_pair(Vec3(x, y, 0.0f), Vec3(x + dx, y + dy, 0.0f));
+    }
+    return segments;
+}
+
+// Nanoseconds per call of the core kernels, without a window: matrix math, line()
+// over several length distributions, triangle(), clear(), the upload conversions
+// and loadOBJ on the given model and on a large generated grid
+void runKernelBenchmark(int iterations, const std::string& modelPath) {
+    initFramebuffer();
+    Random random(12345);
+    float sum = 0.0f;  // Results feed benchmarkSink so no kernel is optimized away
+    int frameOps = std::max(1, iterations / 1000);
+    int loadOps = std::max(1, iterations / 20000);
+    
+    std::cout << "\n=== Kernel Benchmark (" << SCREEN_WIDTH << "x" << SCREEN_HEIGHT << ") ===" << std::endl;
+    std::cout << "kernel                         ops  median_ns/op  best_ns/op" << std::endl;
+    
+    std::vector<Mat4> matrices(64);
+    std::vector<Vec3> points(1024);
+    for (size_t i = 0; i < matrices.size(); i++) {
+        matrices[i] = rotationY(random.uniform(0.0f, 6.28f)) * rotationX(random.uniform(0.0f, 6.28f));
+    }
+    for (auto& point : points) point = Vec3(random.uniform(-1.0f, 1.0f), random.uniform(-1.0f, 1.0f), random.uniform(-1.0f, 1.0f));
+    Mat4 product;
+    Mat4 mvp = perspective(CAMERA_FOV, 4.0f / 3.0f, 0.1f, 100.0f) * translation(0.0f, 0.0f, -3.0f) * matrices[0];
+    
+    // Rotations keep the running product bounded
+    timeKernel("Mat4::operator*", iterations, [&](int i) { product = matrices[i & 63] * product; });
+    sum += product.m[0][0];
+    timeKernel("Mat4::multiply", iterations, [&](int i) { sum += mvp.multiply(points[i & 1023]).x; });
+    
+    const char* lineNames[4] = {"line() short 1-8px", "line() medium 16-64px", "line() long 256-600px", "line() steep 64-256px"};
+    const float lineLengths[4][2] = {{1.0f, 8.0f}, {16.0f, 64.0f}, {256.0f, 600.0f}, {64.0f, 256.0f}};
+    for (int d = 0; d < 4; d++) {
+        std::vector<std::pair<Vec3, Vec3>> segments = randomSegments(random, lineLengths[d][0], lineLengths[d][1], d == 3);
+        timeKernel(lineNames[d], iterations, [&](int i) { line(segments[i & 4095].first, segments[i & 4095].second); });
+    }
+    
+    std::vector<std::pair<Vec3, Vec3>> edges = randomSegments(random, 20.0f, 100.0f, false);
+    timeKernel("triangle() 20-100px", iterations, [&](int i) {
+        const std::pair<Vec3, Vec3>& a = edges[i & 4095];
+        const std::pair<Vec3, Vec3>& b = edges[(i + 1) & 4095];
+        triangle(a.first, a.second, Vec3((a.first.x + b.second.x) * 0.5f, (a.first.y + b.second.y) * 0.5f, 0.0f));
+    });
+    sum += framebuffer[SCREEN_WIDTH * (SCREEN_HEIGHT / 2) + SCREEN_WIDTH / 2];
+    
+    bool savedDirty = dirtyRectsEnabled;
+    dirtyRectsEnabled = false;
+    timeKernel("clear() frame", frameOps, [&](int) {
+        framebufferPreCleared = false;
+        clear();
+    });
+    dirtyRectsEnabled = savedDirty;
+    
+    // The upload conversions renderBuffer uses, into a pitched texture-sized buffer
+    int pitch = SCREEN_WIDTH + 16;
+    std::vector<uint32_t> texture(static_cast<size_t>(pitch) * SCREEN_HEIGHT);
+    PixelView view = {texture.data(), SCREEN_WIDTH, SCREEN_HEIGHT, pitch};
+    timeKernel("upload row memcpy", frameOps, [&](int) {
+        for (int y = 0; y < SCREEN_HEIGHT; y++) {
+            memcpy(view.row(y), &framebuffer[static_cast<size_t>(y) * SCREEN_WIDTH], SCREEN_WIDTH * sizeof(uint32_t));
+        }
+    });
+    timeKernel("upload copyAndClear", frameOps, [&](int) { copyAndClear(view, framebuffer.data(), SCREEN_WIDTH); });
+    timeKernel("upload SDL_ConvertPixels", frameOps, [&](int) {
+        SDL_ConvertPixels(SCREEN_WIDTH, SCREEN_HEIGHT, SDL_PIXELFORMAT_ARGB8888, framebuffer.data(), SCREEN_WIDTH * sizeof(uint32_t),
+                          SDL_PIXELFORMAT_ABGR8888, texture.data(), pitch * sizeof(uint32_t));
+    });
+    sum += texture[pitch * (SCREEN_HEIGHT / 2)];
+    
+    // loadOBJ prints a summary per call; keep it out of the table
+    std::vector<Vec3> vertices;
+    std::vector<Face> faces;
+    std::ostringstream discarded;
+    auto quietLoad = [&](const std::string& path) {
+        std::streambuf* savedOutput = std::cout.rdbuf(discarded.rdbuf());
+        vertices.clear();
+        faces.clear();
+        loadOBJ(path, vertices, faces);
+        std::cout.rdbuf(savedOutput);
+        discarded.str("");
+    };
+    if (std::ifstream(modelPath)) {
+        timeKernel("loadOBJ model", loadOps, [&](int) { quietLoad(modelPath); });
+        sum += static_cast<float>(faces.size());
+    }
+    // The grid is parsed from memory, so no file is left behind if the run is cut short
+    const std::string grid = gridOBJ(512);
+    timeKernel("parseOBJ 512x512 grid", loadOps, [&](int) {
+        std::streambuf* savedOutput = std::cout.rdbuf(discarded.rdbuf());
+        std::istringstream in(grid);
+        vertices.clear();
+        faces.clear();
+        parseOBJ(in, vertices, faces);
+        std::cout.rdbuf(savedOutput);
+        discarded.str("");
+    });
+    sum += static_cast<float>(faces.size());
+    
+    benchmarkSink = static_cast<uint32_t>(sum);
+    std::cout << "================================\n" << std::endl;
+}
+
+// Compare full frame times (render + present) for every present strategy
+void runPresentBenchmark(int frames = 100) {
+    PresentStrategy savedStrategy = presentStrategy;
+    float savedAngle = cameraAngleY;
+    double ticksToMs = 1000.0 / SDL_GetPerformanceFrequency();
+    
+    std::cout << "\n=== Present Benchmark (" << frames << " frames) ===" << std::endl;
+    int first = (savedStrategy == PRESENT_WINDOW_SURFACE) ? PRESENT_WINDOW_SURFACE : 0;
+    int last = (savedStrategy == PRESENT_WINDOW_SURFACE) ? PRESENT_WINDOW_SURFACE : PRESENT_DIRECT_TO_TEXTURE;
+    bool savedDirty = dirtyRectsEnabled;
+    for (int i = first; i <= last + 1; i++) {
+        // The extra pass repeats the default strategy with dirty rectangles
+        dirtyRectsEnabled = i > last;
+        dirtyHistoryValid = false;
+        presentStrategy = static_cast<PresentStrategy>(i > last ? (first == 0 ? PRESENT_PERSISTENT_TEXTURE : first) : i);
+        
+        size_t cleared = 0, uploaded = 0;
+        Uint64 start = SDL_GetPerformanceCounter();
+        for (int frame = 0; frame < frames; frame++) {
+            cameraAngleY = savedAngle + frame * 0.016f;
+            renderScene();
+            renderBuffer(renderer);
+            cleared += bytesCleared;
+            uploaded += bytesUploaded;
+        }
+        double frameMs = (SDL_GetPerformanceCounter() - start) * ticksToMs / frames;
+        std::cout << presentStrategyName(presentStrategy) << (dirtyRectsEnabled ? " + dirty rects" : "") << ": "
+                  << frameMs << " ms/frame, cleared " << cleared / frames / 1024 << " KB/frame, uploaded "
+                  << uploaded / frames / 1024 << " KB/frame" << std::endl;
+    }
+    std::cout << "================================\n" << std::endl;
+    
+    dirtyRectsEnabled = savedDirty;
+    dirtyHistoryValid = false;
+    presentStrategy = savedStrategy;
+    cameraAngleY = savedAngle;
+}
+
+// Compare the linear and tiled framebuffer layouts on raster-heavy workloads
+void runTiledBenchmark(int iterations = 20) {
+    bool savedTiled = tiledEnabled;
+    bool savedDirty = dirtyRectsEnabled;
+    float savedAngle = cameraAngleY;
+    double ticksToMs = 1000.0 / SDL_GetPerformanceFrequency();
+    dirtyRectsEnabled = false;
+    
+    std::cout << "\n=== Tiled Framebuffer Benchmark (" << iterations << " iterations) ===" << std::endl;
+    std::cout << "layout  steep_lines_ms  filled_tris_ms  frame_ms" << std::endl;
+    
+    for (int layout = 0; layout < 2; layout++) {
+        tiledEnabled = layout == 1;
+        framebufferPreCleared = false;
+        dirtyHistoryValid = false;
+        clear();
+        
+        // Near-vertical lines across the whole screen height
+        Uint64 start = SDL_GetPerformanceCounter();
+        for (int it = 0; it < iterations; it++) {
+            for (int i = 0; i < 2000; i++) {
+                float x = static_cast<float>((i * 37 + it) % SCREEN_WIDTH);
+                line(Vec3(x, 0, 0), Vec3(x + (i % 17) - 8, SCREEN_HEIGHT - 1, 0));
+            }
+        }
+        double linesMs = (SDL_GetPerformanceCounter() - start) * ticksToMs / iterations;
+        
+        // Tall, narrow triangles filled with horizontal spans
+        start = SDL_GetPerformanceCounter();
+        for (int it = 0; it < iterations; it++) {
+            for (int i = 0; i < 200; i++) {
+                int apexX = (i * 53 + it) % SCREEN_WIDTH;
+                for (int y = 0; y < SCREEN_HEIGHT; y++) {
+                    int halfWidth = y * 24 / SCREEN_HEIGHT;
+                    for (int x = apexX - halfWidth; x <= apexX + halfWidth; x++) pixel(x, y);
+                }
+            }
+        }
+        double trianglesMs = (SDL_GetPerformanceCounter() - start) * ticksToMs / iterations;
+        
+        // Whole frames: render, detile or copy, present
+        dirtyHistoryValid = false;
+        start = SDL_GetPerformanceCounter();
+        for (int it = 0; it < iterations; it++) {
+            cameraAngleY = savedAngle + it * 0.016f;
+            renderScene();
+            renderBuffer(renderer);
+        }
+        double frameMs = (SDL_GetPerformanceCounter() - start) * ticksToMs / iterations;
+        
+        char row[96];
+        snprintf(row, sizeof(row), "%-6s  %14.3f  %14.3f  %8.3f", tiledEnabled ? "tiled" : "linear", linesMs, trianglesMs, frameMs);
+        std::cout << row << std::endl;
+    }
+    std::cout << "================================\n" << std::endl;
+    
+    tiledEnabled = savedTiled;
+    dirtyRectsEnabled = savedDirty;
+    dirtyHistoryValid = false;
+    framebufferPreCleared = false;
+    cameraAngleY = savedAngle;
+}
+
+// Paces animated frames to a target rate and measures how evenly they start
+struct FramePacer {
+    double targetFps;
+    Uint64 period;      // Performance counter ticks per frame
+    Uint64 nextFrame;   // When the next frame is due
+    Uint64 lastFrame;   // When the previous frame started, 0 until the first one
+    
+    // Interval statistics since the last report
+    int frames;
+    double intervalSum, intervalSquares, worstDeviation;
+    Uint64 reportStart;
+    
+    FramePacer() {
+        setRate(60.0);
+    }
+    
+    void setRate(double fps) {
+        targetFps = fps;
+        period = static_cast<Uint64>(SDL_GetPerformanceFrequency() / fps);
+        reset();
+    }
+    
+    // Start over, e.g. when animation is switched on after idling
+    void reset() {
+        nextFrame = SDL_GetPerformanceCounter();
+        lastFrame = 0;
+        frames = 0;
+        intervalSum = intervalSquares = worstDeviation = 0.0;
+        reportStart = nextFrame;
+    }
+    
+    // Milliseconds an event wait may block before the next frame, rounded down
+    int msUntilNextFrame() const {
+        Uint64 now = SDL_GetPerformanceCounter();
+        if (now >= nextFrame) return 0;
+        return static_cast<int>((nextFrame - now) * 1000 / SDL_GetPerformanceFrequency());
+    }
+    
+    // True once the next frame is due. The last couple of milliseconds are spun
+    // on the performance counter because sleeps and event waits overshoot.
+    bool frameDue() const {
+        Uint64 spinTicks = SDL_GetPerformanceFrequency() / 500;
+        Uint64 now = SDL_GetPerformanceCounter();
+        if (now + spinTicks < nextFrame) return false;
+        while (now < nextFrame) now = SDL_GetPerformanceCounter();
+        return true;
+    }
+    
+    // Start a frame: returns seconds since the previous one and schedules the next
+    float beginFrame() {
+        Uint64 now = SDL_GetPerformanceCounter();
+        double freq = static_cast<double>(SDL_GetPerformanceFrequency());
+        double elapsed = lastFrame ? (now - lastFrame) / freq : 1.0 / targetFps;
+        
+        if (lastFrame) {
+            double intervalMs = elapsed * 1000.0;
+            intervalSum += intervalMs;
+            intervalSquares += intervalMs * intervalMs;
+            worstDeviation = std::max(worstDeviation, std::fabs(intervalMs - 1000.0 / targetFps));
+            frames++;
+        }
+        lastFrame = now;
+        // A slow frame pushes the schedule back instead of bunching up catch-up frames
+        nextFrame = std::max(nextFrame + period, now);
+        
+        if (frames > 0 && (now - reportStart) / freq >= 2.0) {
+            double mean = intervalSum / frames;
+            double deviation = std::sqrt(std::max(0.0, intervalSquares / frames - mean * mean));
+            char row[128];
+            snprintf(row, sizeof(row), "Pacing: %.1f fps, interval %.2f ms +/- %.3f ms, worst %.3f ms off target",
+                     1000.0 / mean, mean, deviation, worstDeviation);
+            std::cout << row << std::endl;
+            frames = 0;
+            intervalSum = intervalSquares = worstDeviation = 0.0;
+            reportStart = now;
+        }
+        return static_cast<float>(elapsed);
+    }
+};
+
+FramePacer framePacer;
+
+// Block until an event arrives; while animating, only until the next frame is due
+bool waitForEvent(SDL_Event* event) {
+    if (!autoRotate) return SDL_WaitEvent(event) != 0;
+    int ms = framePacer.msUntilNextFrame() - 2;  // Leave the rest to frameDue()'s spin
+    if (ms <= 0) return SDL_PollEvent(event) != 0;
+    return SDL_WaitEventTimeout(event, ms) != 0;
+}
+
+// What the events handled in one loop iteration asked for
+struct InputResult {
+    bool quit;
+    bool render;   // Camera or settings changed
+    bool present;  // Only the presentation changed (monochrome recolor)
+};
+
+// Session files: an 8-byte magic and the window size, then fixed 17-byte records of a
+// kind byte, milliseconds since the session started and three 32-bit fields
+const char SESSION_MAGIC[8] = {'O', 'B', 'J', 'S', 'E', 'S', 'S', '1'};
+
+enum SessionRecordKind {
+    RECORD_KEY = 'K',      // sym, repeat
+    RECORD_RESIZE = 'W',   // width, height
+    RECORD_FRAME = 'F',    // camera angleX, angleY, distance as float bits
+    RECORD_PRESENT = 'P'   // Presented again without rendering
+};
+
+struct SessionRecord {
+    uint8_t kind;
+    uint32_t timeMs;
+    int32_t fields[3];
+};
+
+// Records the input of an interactive session and the camera of every frame it drew
+struct SessionRecorder {
+    FILE* file;
+    Uint32 startTicks;
+    size_t records;
+    
+    SessionRecorder() : file(nullptr), startTicks(0), records(0) {}
+    
+    bool open(const std::string& path) {
+        file = fopen(path.c_str(), "wb");
+        if (!file) return false;
+        int32_t size[2] = {windowWidth, windowHeight};
+        fwrite(SESSION_MAGIC, 1, sizeof(SESSION_MAGIC), file);
+        fwrite(size, sizeof(int32_t), 2, file);
+        startTicks = SDL_GetTicks();
+        return true;
+    }
+    
+    void write(uint8_t kind, int32_t a, int32_t b, int32_t c) {
+        if (!file) return;
+        uint32_t timeMs = SDL_GetTicks() - startTicks;
+        int32_t fields[3] = {a, b, c};
+        fwrite(&kind, 1, 1, file);
+        fwrite(&timeMs, sizeof(timeMs), 1, file);
+        fwrite(fields, sizeof(int32_t), 3, file);
+        records++;
+    }
+    
+    // Only events that change the camera, settings or window size are kept
+    void event(const SDL_Event& event) {
+        if (event.type == SDL_KEYDOWN) {
+            write(RECORD_KEY, event.key.keysym.sym, event.key.repeat, 0);
+        } else if (event.type == SDL_WINDOWEVENT && event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED) {
+            write(RECORD_RESIZE, event.window.data1, event.window.data2, 0);
+        }
+    }
+    
+    void frame(const CameraState& camera, bool rendered) {
+        int32_t bits[3];
+        memcpy(&bits[0], &camera.angleX, sizeof(float));
+        memcpy(&bits[1], &camera.angleY, sizeof(float));
+        memcpy(&bits[2], &camera.distance, sizeof(float));
+        write(rendered ? RECORD_FRAME : RECORD_PRESENT, bits[0], bits[1], bits[2]);
+    }
+    
+    void close() {
+        if (!file) return;
+        fclose(file);
+        file = nullptr;
+        std::cout << "Recorded " << records << " session records" << std::endl;
+    }
+};
+
+SessionRecorder sessionRecorder;
+
+// Apply one event to the camera and settings; drawing is left to the caller
+void handleEvent(const SDL_Event& event, CameraState& view, InputResult& result) {
+    if (event.type == SDL_QUIT) {
+        result.quit = true;
+    }
+    
+    if (event.type == SDL_WINDOWEVENT && event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED) {
+        windowWidth = std::max(1, static_cast<int>(event.window.data1));
+        windowHeight = std::max(1, static_cast<int>(event.window.data2));
+        resizeRender();
+        result.render = true;
+    }
+    
+    if (event.type == SDL_KEYDOWN) {
+        bool needsRender = true;
+        
+        // Anything but camera keys changes state the render thread reads
+        SDL_Keycode key = event.key.keysym.sym;
+        bool cameraKey = key == SDLK_LEFT || key == SDLK_RIGHT || key == SDLK_UP || key == SDLK_DOWN ||
+                         key == SDLK_w || key == SDLK_s || key == SDLK_r || key == SDLK_a;
+        if (!cameraKey) stopRenderThread();
+        
+        switch(key) {
+            // Rotation controls
+            case SDLK_LEFT:
+                view.angleY -= 0.1f;
+                break;
+            case SDLK_RIGHT:
+                view.angleY += 0.1f;
+                break;
+            case SDLK_UP:
+                view.angleX -= 0.1f;
+                break;
+            case SDLK_DOWN:
+                view.angleX += 0.1f;
+                break;
+                
+            // Zoom controls
+            case SDLK_w:
+                view.distance -= 0.2f;
+                if (view.distance < 1.0f) view.distance = 1.0f;
+                break;
+            case SDLK_s:
+                view.distance += 0.2f;
+                if (view.distance > 10.0f) view.distance = 10.0f;
+                break;
+                
+            // Auto-rotation toggle
+            case SDLK_a:
+                autoRotate = !autoRotate;
+                framePacer.reset();
+                std::cout << "Auto-rotation: " << (autoRotate ? "ON" : "OFF") << std::endl;
+                break;
+                
+            // Level of detail toggle
+            case SDLK_l:
+                lodEnabled = !lodEnabled;
+                std::cout << "Level of detail: " << (lodEnabled ? "ON" : "OFF") << std::endl;
+                break;
+                
+            // Progressive mesh toggle
+            case SDLK_p:
+                progressiveEnabled = !progressiveEnabled;
+                std::cout << "Progressive mesh: " << (progressiveEnabled ? "ON" : "OFF") << std::endl;
+                break;
+                
+            // Visibility cache toggle
+            case SDLK_v:
+                if (visibilityCache.empty()) {
+                    std::cout << "Visibility cache not built, start with --visibility-cache" << std::endl;
+                    needsRender = false;
+                } else {
+                    visibilityCacheEnabled = !visibilityCacheEnabled;
+                    std::cout << "Visibility cache: " << (visibilityCacheEnabled ? "ON" : "OFF") << std::endl;
+                }
+                break;
+                
+            // Coherent culling toggle
+            case SDLK_c:
+                coherentCullingEnabled = !coherentCullingEnabled;
+                std::cout << "Coherent culling: " << (coherentCullingEnabled ? "ON" : "OFF");
+                if (!coherentCullingEnabled) {
+                    std::cout << " (last frame tested " << coherentCuller.lastTested << " of " << coherentCuller.front.size() << " faces)";
+                }
+                std::cout << std::endl;
+                break;
+                
+            // Outline preview toggle
+            case SDLK_e:
+                edgePreviewEnabled = !edgePreviewEnabled;
+                std::cout << "Outline preview: " << (edgePreviewEnabled ? "ON" : "OFF");
+                if (!edgePreviewEnabled) {
+                    std::cout << " (last frame drew " << edgePreviewLines << " of " << meshAdjacency.edges.size() << " edges)";
+                }
+                std::cout << std::endl;
+                break;
+                
+            // Texture upload strategy
+            case SDLK_t:
+                if (presentStrategy == PRESENT_WINDOW_SURFACE) {
+                    std::cout << "Only the window surface is available without a renderer" << std::endl;
+                    break;
+                }
+                presentStrategy = static_cast<PresentStrategy>((presentStrategy + 1) % (PRESENT_DIRECT_TO_TEXTURE + 1));
+                dirtyHistoryValid = false;
+                std::cout << "Present strategy: " << presentStrategyName(presentStrategy) << std::endl;
+                break;
+                
+            // Dirty rectangle toggle
+            case SDLK_d:
+                dirtyRectsEnabled = !dirtyRectsEnabled;
+                dirtyHistoryValid = false;
+                std::cout << "Dirty rectangles: " << (dirtyRectsEnabled ? "ON" : "OFF")
+                          << " (last frame cleared " << bytesCleared << " bytes, uploaded " << bytesUploaded << " bytes)" << std::endl;
+                break;
+                
+            // Monochrome bitplane toggle
+            case SDLK_m:
+                monochromeEnabled = !monochromeEnabled;
+                monochromeFrameValid = false;
+                dirtyHistoryValid = false;
+                std::cout << "Monochrome bitplane: " << (monochromeEnabled ? "ON" : "OFF") << std::endl;
+                break;
+                
+            // Framebuffer layout toggle
+            case SDLK_g:
+                tiledEnabled = !tiledEnabled;
+                framebufferPreCleared = false;
+                dirtyHistoryValid = false;
+                std::cout << "Tiled framebuffer: " << (tiledEnabled ? "ON" : "OFF") << std::endl;
+                break;
+                
+            // Dynamic resolution toggle
+            case SDLK_f:
+                dynamicResolutionEnabled = !dynamicResolutionEnabled;
+                std::cout << "Dynamic resolution: " << (dynamicResolutionEnabled ? "ON" : "OFF")
+                          << " (budget " << frameBudgetMs << " ms)" << std::endl;
+                if (!dynamicResolutionEnabled && renderScale != 1.0f) {
+                    renderScale = 1.0f;
+                    resizeRender();
+                }
+                framesAtScale = 0;
+                break;
+                
+            // Profiler HUD toggle
+            case SDLK_i:
+                SDL_AtomicSet(&hudEnabled, !SDL_AtomicGet(&hudEnabled));
+                SDL_AtomicSet(&profilerEnabled, SDL_AtomicGet(&hudEnabled) || profileCsv.is_open());
+                std::cout << "Profiler HUD: " << (SDL_AtomicGet(&hudEnabled) ? "ON" : "OFF") << std::endl;
+                break;
+                
+            // Write the trace recorded so far
+            case SDLK_k:
+                if (traceEnabled) {
+                    // writeTrace needs every other thread idle; the loop restarts the render thread after this key
+                    stopRenderThread();
+                    writeTrace(tracePath);
+                } else {
+                    std::cout << "Start with --trace <file> to record a trace" << std::endl;
+                }
+                needsRender = false;
+                break;
+                
+            // Render thread toggle
+            case SDLK_h:
+                threadedEnabled = !threadedEnabled;
+                std::cout << "Render thread: " << (threadedEnabled ? "ON" : "OFF") << std::endl;
+                break;
+                
+            // Reset view
+            case SDLK_r:
+                view.angleY = 0.785f;
+                view.angleX = 0.35f;
+                view.distance = 3.0f;
+                autoRotate = false;
+                break;
+                
+            // Color controls
+            case SDLK_1:
+                setColor(Color(255, 0, 0));  // Red
+                break;
+            case SDLK_2:
+                setColor(Color(0, 255, 0));  // Green
+                break;
+            case SDLK_3:
+                setColor(Color(0, 0, 255));  // Blue
+                break;
+            case SDLK_4:
+                setColor(Color(255, 255, 0));  // Yellow
+                break;
+            case SDLK_5:
+                setColor(Color(255, 255, 255));  // White
+                break;
+            case SDLK_6:
+                setColor(Color(0, 255, 255));  // Cyan
+                break;
+            case SDLK_7:
+                setColor(Color(255, 0, 255));  // Magenta
+                break;
+                
+            case SDLK_ESCAPE:
+                result.quit = true;
+                needsRender = false;
+                break;
+                
+            default:
+                needsRender = false;
+                break;
+        }
+        
+        if (threadedEnabled && !result.quit && !startRenderThread()) {
+            std::cout << "Render thread needs an accelerated renderer without monochrome or tiled mode" << std::endl;
+            threadedEnabled = false;
+        }
+        
+        // Monochrome frames take their color at present time, so recoloring needs no redraw
+        bool colorOnly = key >= SDLK_1 && key <= SDLK_7;
+        if (needsRender && colorOnly && monochromeEnabled && monochromeFrameValid) {
+            result.present = true;
+        } else if (needsRender) {
+            result.render = true;
+        }
+    }
+}
+
+// One pass of the main loop: wait for input, apply every pending event, then draw
+// at most one frame for all of them. Returns false once asked to quit.
+bool runLoopIteration(CameraState& view) {
+    InputResult input = {false, false, false};
+    SDL_Event event;
+    
+    // Sleep in the event wait rather than a fixed delay, so input is handled as it arrives
+    bool haveEvent;
+    {
+        TraceZone zone("waitForEvent");
+        haveEvent = waitForEvent(&event);
+    }
+    for (; haveEvent; haveEvent = SDL_PollEvent(&event) != 0) {
+        handleEvent(event, view, input);
+        sessionRecorder.event(event);
+    }
+    if (input.quit) return false;
+    
+    if (autoRotate) {
+        // Input rides along with the next paced frame
+        if (framePacer.frameDue()) {
+            view.angleY += framePacer.beginFrame() * 1.0f;  // Rotate 1 radian per second
+            requestFrame(view);
+            sessionRecorder.frame(view, true);
+        }
+    } else if (input.render) {
+        requestFrame(view);
+        sessionRecorder.frame(view, true);
+    } else if (input.present) {
+        renderBuffer(renderer);
+        finishProfiledFrame(nullptr, nullptr);
+        sessionRecorder.frame(view, false);
+    }
+    
+    // Frames from the render thread are presented here, between input batches
+    if (renderThread) {
+        const RenderedFrame* frame = presentRenderedFrame(renderer);
+        if (frame) finishProfiledFrame(frame->stageTicks, frame->stageCounters);
+        if (frame && updateRenderScale(frame->renderMs)) resizeRender();
+    }
+    return true;
+}
+
+// Push a burst of synthetic key repeats and check that they produce exactly one frame
+bool runInputCoalescingCheck(CameraState& view) {
+    const int events = 100;
+    bool savedAutoRotate = autoRotate;
+    autoRotate = false;
+    float expectedAngle = view.angleY;
+    
+    for (int i = 0; i < events; i++) {
+        SDL_Event event = {};
+        event.type = SDL_KEYDOWN;
+        event.key.state = SDL_PRESSED;
+        event.key.repeat = i > 0;
+        event.key.keysym.sym = SDLK_LEFT;
+        SDL_PushEvent(&event);
+        expectedAngle -= 0.1f;
+    }
+    
+    size_t framesBefore = frameRequests;
+    runLoopIteration(view);
+    size_t frames = frameRequests - framesBefore;
+    bool passed = frames == 1 && std::fabs(view.angleY - expectedAngle) < 1e-3f;
+    
+    std::cout << "Input coalescing: " << events << " key events -> " << frames << " frame(s), camera "
+              << (std::fabs(view.angleY - expectedAngle) < 1e-3f ? "up to date" : "wrong") << ": "
+              << (passed ? "PASS" : "FAIL") << std::endl;
+    autoRotate = savedAutoRotate;
+    return passed;
+}
+
+// Compare presented frame rate and input-to-present latency with and without the render thread
+void runThreadBenchmark(int frames = 100) {
+    if (!canRenderThreaded()) {
+        std::cout << "Thread benchmark needs an accelerated renderer without monochrome or tiled mode" << std::endl;
+        return;
+    }
+    CameraState start = captureCamera();
+    double ticksToMs = 1000.0 / SDL_GetPerformanceFrequency();
+    
+    std::cout << "\n=== Render Thread Benchmark (" << frames << " frames) ===" << std::endl;
+    std::cout << "mode           frames/s  latency_avg_ms  latency_max_ms" << std::endl;
+    
+    for (int threaded = 0; threaded < 2; threaded++) {
+        if (threaded && !startRenderThread()) break;
+        
+        double latencySum = 0, latencyMax = 0;
+        int presented = 0, step = 0;
+        Uint64 begin = SDL_GetPerformanceCounter();
+        while (presented < frames) {
+            // A new camera every iteration, like continuous mouse or key-repeat input
+            CameraState camera = start;
+            camera.angleY += step++ * 0.016f;
+            camera.inputCounter = SDL_GetPerformanceCounter();
+            requestFrame(camera);
+            
+            Uint64 inputCounter = camera.inputCounter;
+            if (threaded) {
+                const RenderedFrame* frame = presentRenderedFrame(renderer);
+                if (frame == nullptr) {
+                    SDL_Delay(1);
+                    continue;
+                }
+                inputCounter = frame->inputCounter;
+            }
+            double latency = (SDL_GetPerformanceCounter() - inputCounter) * ticksToMs;
+            latencySum += latency;
+            latencyMax = std::max(latencyMax, latency);
+            presented++;
+        }
+        double elapsedMs = (SDL_GetPerformanceCounter() - begin) * ticksToMs;
+        
+        char row[96];
+        snprintf(row, sizeof(row), "%-13s  %8.1f  %14.3f  %14.3f", threaded ? "render thread" : "single thread",
+                 frames * 1000.0 / elapsedMs, latencySum / frames, latencyMax);
+        std::cout << row << std::endl;
+    }
+    std::cout << "================================\n" << std::endl;
+    
+    stopRenderThread();
+    applyCamera(start);
+}
+
+// Step the camera like arrow key presses for one refresh interval and compare the
+// incremental culler with a brute-force facing and silhouette test of every face
+bool runCoherentCullingCheck(const std::vector<Vec3>& vertices, const std::vector<Face>& faces) {
+    MeshAdjacency adjacency;
+    adjacency.build(vertices, faces);
+    CoherentCuller culler;
+
+    // Right twice, left twice, up, down: faces flip and have to flip back as the eye returns
+    const float steps[6][2] = {{0.0f, 0.1f}, {0.0f, 0.1f}, {0.0f, -0.1f}, {0.0f, -0.1f}, {-0.1f, 0.0f}, {0.1f, 0.0f}};
+    const float distances[3] = {1.5f, 3.0f, 6.0f};
+    int frames = 0, wrongFrames = 0;
+    size_t wrongFaces = 0;
+    std::vector<uint8_t> onFrontier(faces.size());
+    for (float distance : distances) {
+        culler.reset(adjacency);
+        cameraAngleX = 0.35f;
+        cameraAngleY = 0.785f;
+        cameraDistance = distance;
+        for (int i = 0; i < culler.fullRefreshInterval - 1; i++, frames++) {
+            if (i > 0) {
+                cameraAngleX += steps[(i - 1) % 6][0];
+                cameraAngleY += steps[(i - 1) % 6][1];
+            }
+            Vec3 eye = cameraPosition();
+            const std::vector<int>& visible = culler.update(eye);
+
+            std::fill(onFrontier.begin(), onFrontier.end(), 0);
+            for (int f : culler.frontier) onFrontier[f] = 1;
+            size_t wrong = 0, frontCount = 0;
+            for (size_t f = 0; f < faces.size(); f++) {
+                bool isFront = adjacency.frontFacing(static_cast<int>(f), eye);
+                bool silhouette = false;
+                for (int n : adjacency.faceNeighbors[f]) {
+                    if (adjacency.frontFacing(n, eye) != isFront) silhouette = true;
+                }
+                frontCount += isFront;
+                if ((culler.front[f] != 0) != isFront || (onFrontier[f] != 0) != silhouette) wrong++;
+            }
+            if (visible.size() != frontCount) wrong++;
+            if (wrong) {
+                wrongFrames++;
+                wrongFaces += wrong;
+            }
+        }
+    }
+
+    bool passed = wrongFrames == 0;
+    std::cout << "Coherent culling: " << frames << " frames, " << wrongFaces << " wrong faces";
+    if (wrongFrames) std::cout << " in " << wrongFrames << " wrong frames";
+    std::cout << ": " << (passed ? "PASS" : "FAIL") << std::endl;
+    return passed;
+}
+
+// Copy the last rendered frame into a linear ARGB image, whatever the framebuffer layout
+void captureFrame(std::vector<uint32_t>& image) {
+    image.resize(static_cast<size_t>(SCREEN_WIDTH) * SCREEN_HEIGHT);
+    PixelView view = {image.data(), SCREEN_WIDTH, SCREEN_HEIGHT, SCREEN_WIDTH};
+    if (monochromeEnabled) {
+        expandBitplane(view, currentPixel, BACKGROUND_PIXEL);
+    } else if (tiledEnabled) {
+        detile(view, DirtyRect(0, 0, SCREEN_WIDTH - 1, SCREEN_HEIGHT - 1), false);
+    } else {
+        for (int y = 0; y < SCREEN_HEIGHT; y++) {
+            memcpy(view.row(y), drawTarget.row(y), SCREEN_WIDTH * sizeof(uint32_t));
+        }
+    }
+}
+
+// Write an ARGB image as binary PPM (P6)
+bool writePPM(const std::string& path, const std::vector<uint32_t>& image, int width, int height) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) return false;
+    out << "P6\n" << width << " " << height << "\n255\n";
+    std::vector<uint8_t> row(width * 3);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            uint32_t p = image[static_cast<size_t>(y) * width + x];
+            row[x * 3] = static_cast<uint8_t>(p >> 16);
+            row[x * 3 + 1] = static_cast<uint8_t>(p >> 8);
+            row[x * 3 + 2] = static_cast<uint8_t>(p);
+        }
+        out.write(reinterpret_cast<const char*>(row.data()), row.size());
+    }
+    return static_cast<bool>(out);
+}
+
+// Append a PNG chunk: big-endian length, type, data and the CRC of type and data
+void writePNGChunk(std::ofstream& out, const char* type, const std::vector<uint8_t>& data) {
+    static uint32_t crcTable[256];
+    if (crcTable[1] == 0) {
+        for (uint32_t n = 0; n < 256; n++) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            crcTable[n] = c;
+        }
+    }
+    uint32_t crc = 0xFFFFFFFFu;
+    for (int i = 0; i < 4; i++) crc = crcTable[(crc ^ static_cast<uint8_t>(type[i])) & 0xFF] ^ (crc >> 8);
+    for (uint8_t byte : data) crc = crcTable[(crc ^ byte) & 0xFF] ^ (crc >> 8);
+    crc ^= 0xFFFFFFFFu;
     
-    // Create perspective projection
-    float fov = 3.14159f / 4.0f;  // 45 degrees
-    float aspect = (float)SCREEN_WIDTH / (float)SCREEN_HEIGHT;
-    Mat4 projection = perspective(fov, aspect, 0.1f, 100.0f);
+    uint32_t length = static_cast<uint32_t>(data.size());
+    uint8_t header[8] = {static_cast<uint8_t>(length >> 24), static_cast<uint8_t>(length >> 16),
+                         static_cast<uint8_t>(length >> 8), static_cast<uint8_t>(length),
+                         static_cast<uint8_t>(type[0]), static_cast<uint8_t>(type[1]),
+                         static_cast<uint8_t>(type[2]), static_cast<uint8_t>(type[3])};
+    uint8_t trailer[4] = {static_cast<uint8_t>(crc >> 24), static_cast<uint8_t>(crc >> 16),
+                          static_cast<uint8_t>(crc >> 8), static_cast<uint8_t>(crc)};
+    out.write(reinterpret_cast<const char*>(header), 8);
+    out.write(reinterpret_cast<const char*>(data.data()), data.size());
+    out.write(reinterpret_cast<const char*>(trailer), 4);
+}
+
+// Write an ARGB image as 8-bit RGB PNG. The zlib stream uses stored (uncompressed)
+// deflate blocks, so no compression library is needed; files are about PPM sized.
+bool writePNG(const std::string& path, const std::vector<uint32_t>& image, int width, int height) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) return false;
+    const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    out.write(reinterpret_cast<const char*>(signature), 8);
     
-    // Combine all transformations
-    Mat4 mvp = projection * translationMat * rotation * modelMatrix;
+    std::vector<uint8_t> header(13, 0);
+    for (int i = 0; i < 4; i++) {
+        header[i] = static_cast<uint8_t>(width >> (24 - 8 * i));
+        header[4 + i] = static_cast<uint8_t>(height >> (24 - 8 * i));
+    }
+    header[8] = 8;  // Bits per channel
+    header[9] = 2;  // Truecolor
+    writePNGChunk(out, "IHDR", header);
     
-    // Transform all vertices
-    std::vector<Vec3> transformedVertices;
-    for (const auto& vertex : vertices) {
-        Vec3 transformed = mvp.multiply(vertex);
-        
-        // Convert from normalized device coordinates to screen coordinates
-        transformed.x = (transformed.x + 1.0f) * 0.5f * SCREEN_WIDTH;
-        transformed.y = (1.0f - transformed.y) * 0.5f * SCREEN_HEIGHT;  // Flip Y axis
-        
-        transformedVertices.push_back(transformed);
+    // Every scanline starts with filter type 0 (none)
+    std::vector<uint8_t> raw;
+    raw.reserve(static_cast<size_t>(height) * (width * 3 + 1));
+    for (int y = 0; y < height; y++) {
+        raw.push_back(0);
+        for (int x = 0; x < width; x++) {
+            uint32_t p = image[static_cast<size_t>(y) * width + x];
+            raw.push_back(static_cast<uint8_t>(p >> 16));
+            raw.push_back(static_cast<uint8_t>(p >> 8));
+            raw.push_back(static_cast<uint8_t>(p));
+        }
     }
     
-    // Draw all triangles
-    int triangleCount = 0;
-    for (const auto& face : faces) {
-        if (face.vertexIndices.size() >= 3) {
-            // Check if vertices are valid
-            bool validFace = true;
-            for (const auto& idx : face.vertexIndices) {
-                if (idx[0] >= transformedVertices.size()) {
-                    validFace = false;
-                    break;
-                }
+    // zlib header, stored blocks of at most 65535 bytes, then the Adler-32 of the raw data
+    std::vector<uint8_t> compressed;
+    compressed.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+    compressed.push_back(0x78);
+    compressed.push_back(0x01);
+    size_t offset = 0;
+    do {
+        size_t block = std::min<size_t>(raw.size() - offset, 65535);
+        bool last = offset + block == raw.size();
+        compressed.push_back(last ? 1 : 0);
+        compressed.push_back(static_cast<uint8_t>(block));
+        compressed.push_back(static_cast<uint8_t>(block >> 8));
+        compressed.push_back(static_cast<uint8_t>(~block));
+        compressed.push_back(static_cast<uint8_t>(~block >> 8));
+        compressed.insert(compressed.end(), raw.begin() + offset, raw.begin() + offset + block);
+        offset += block;
+    } while (offset < raw.size());
+    uint32_t a = 1, b = 0;
+    for (size_t start = 0; start < raw.size(); start += 5552) {
+        // 5552 bytes is the most that can be summed before the 32-bit sums may overflow
+        size_t end = std::min<size_t>(raw.size(), start + 5552);
+        for (size_t i = start; i < end; i++) {
+            a += raw[i];
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    uint32_t adler = (b << 16) | a;
+    for (int shift = 24; shift >= 0; shift -= 8) compressed.push_back(static_cast<uint8_t>(adler >> shift));
+    writePNGChunk(out, "IDAT", compressed);
+    writePNGChunk(out, "IEND", std::vector<uint8_t>());
+    return static_cast<bool>(out);
+}
+
+// Read a binary PPM (P6, 8 bits per channel) into opaque ARGB pixels
+bool readPPM(const std::string& path, std::vector<uint32_t>& image, int& width, int& height) {
+    std::ifstream in(path, std::ios::binary);
+    std::string magic;
+    int maxValue = 0;
+    if (!(in >> magic >> width >> height >> maxValue) || magic != "P6" || maxValue != 255 || width <= 0 || height <= 0) return false;
+    in.get();  // The single whitespace byte before the pixels
+    
+    std::vector<uint8_t> bytes(static_cast<size_t>(width) * height * 3);
+    if (!in.read(reinterpret_cast<char*>(bytes.data()), bytes.size())) return false;
+    image.resize(static_cast<size_t>(width) * height);
+    for (size_t i = 0; i < image.size(); i++) {
+        image[i] = 0xFF000000u | (bytes[i * 3] << 16) | (bytes[i * 3 + 1] << 8) | bytes[i * 3 + 2];
+    }
+    return true;
+}
+
+// A fixed view of the model checked against a stored reference image
+struct GoldenCase {
+    const char* name;
+    float angleX, angleY, distance;
+    Color color;
+    int tolerance;  // Largest per-channel difference accepted; wireframe output must match exactly
+};
+
+// Render every golden case in each framebuffer layout and compare with the references
+// in dir, or with update write new references from the linear layout. Mismatches
+// leave <case>_<layout>.actual.ppm and .diff.ppm next to the references.
+bool runGoldenImages(const std::vector<Vec3>& vertices, const std::vector<Face>& faces, const std::string& dir, bool update) {
+    const GoldenCase cases[] = {
+        {"front", 0.0f, 0.0f, 3.0f, Color(255, 255, 0), 0},
+        {"diagonal", 0.35f, 0.785f, 3.0f, Color(255, 255, 0), 0},
+        {"top", 1.2f, 0.3f, 4.0f, Color(0, 255, 255), 0},
+        {"near", 0.2f, 2.5f, 1.5f, Color(255, 0, 0), 0},
+        {"far", 0.5f, 4.0f, 8.0f, Color(255, 255, 255), 0},
+        {"back", -0.4f, 3.14159f, 3.0f, Color(255, 0, 255), 0},
+    };
+    const char* layouts[3] = {"linear", "tiled", "monochrome"};
+    
+    // References are small so they stay cheap to store
+    windowWidth = SCREEN_WIDTH = 320;
+    windowHeight = SCREEN_HEIGHT = 240;
+    initFramebuffer();
+    dirtyRectsEnabled = false;
+    
+    int failures = 0;
+    std::vector<uint32_t> actual, expected;
+    for (const GoldenCase& golden : cases) {
+        std::string reference = dir + "/" + golden.name + ".ppm";
+        cameraAngleX = golden.angleX;
+        cameraAngleY = golden.angleY;
+        cameraDistance = golden.distance;
+        setColor(golden.color);
+        
+        for (int layout = 0; layout < (update ? 1 : 3); layout++) {
+            tiledEnabled = layout == 1;
+            monochromeEnabled = layout == 2;
+            render(vertices, faces);
+            captureFrame(actual);
+            
+            if (update) {
+                bool written = writePPM(reference, actual, SCREEN_WIDTH, SCREEN_HEIGHT);
+                std::cout << (written ? "Wrote " : "Could not write ") << reference << std::endl;
+                failures += !written;
+                continue;
             }
             
-            if (!validFace) continue;
+            int width = 0, height = 0;
+            if (!readPPM(reference, expected, width, height) || width != SCREEN_WIDTH || height != SCREEN_HEIGHT) {
+                std::cout << golden.name << " " << layouts[layout] << ": FAIL, no usable reference " << reference
+                          << " (run --golden-update)" << std::endl;
+                failures++;
+                continue;
+            }
             
-            // Draw first triangle
-            Vec3 v1 = transformedVertices[face.vertexIndices[0][0]];
-            Vec3 v2 = transformedVertices[face.vertexIndices[1][0]];
-            Vec3 v3 = transformedVertices[face.vertexIndices[2][0]];
+            // Differing pixels are red in the diff, matching ones a dim copy of the reference
+            size_t differing = 0;
+            int worst = 0;
+            std::vector<uint32_t> diff(actual.size());
+            for (size_t i = 0; i < actual.size(); i++) {
+                int delta = 0;
+                for (int shift = 0; shift < 24; shift += 8) {
+                    delta = std::max(delta, std::abs(static_cast<int>((actual[i] >> shift) & 0xFF) - static_cast<int>((expected[i] >> shift) & 0xFF)));
+                }
+                worst = std::max(worst, delta);
+                if (delta > golden.tolerance) differing++;
+                diff[i] = delta > golden.tolerance ? 0xFFFF0000u : 0xFF000000u | ((expected[i] >> 2) & 0x3F3F3F);
+            }
             
-            // Simple back-face culling (optional)
-            // Calculate normal using cross product
-            Vec3 edge1 = v2 - v1;
-            Vec3 edge2 = v3 - v1;
-            float normalZ = edge1.x * edge2.y - edge1.y * edge2.x;
+            if (differing == 0) {
+                std::cout << golden.name << " " << layouts[layout] << ": ok" << std::endl;
+                continue;
+            }
+            std::string base = dir + "/" + golden.name + "_" + layouts[layout];
+            writePPM(base + ".actual.ppm", actual, SCREEN_WIDTH, SCREEN_HEIGHT);
+            writePPM(base + ".diff.ppm", diff, SCREEN_WIDTH, SCREEN_HEIGHT);
+            std::cout << golden.name << " " << layouts[layout] << ": FAIL, " << differing << " pixels differ (max channel delta "
+                      << worst << "), see " << base << ".diff.ppm" << std::endl;
+            failures++;
+        }
+    }
+    tiledEnabled = false;
+    monochromeEnabled = false;
+    
+    std::cout << (failures ? "Golden images: FAILED" : "Golden images: passed") << std::endl;
+    return failures == 0;
+}
+
+// Camera of frame i of the --benchmark path: two orbits while zooming out and back
+// in and tilting up and down, so near and far views are both measured
+CameraState benchmarkCamera(int frame, int frames) {
+    const float TWO_PI = 2.0f * 3.14159f;
+    float t = frames > 1 ? static_cast<float>(frame) / (frames - 1) : 0.0f;
+    CameraState camera;
+    camera.angleY = 0.785f + 2.0f * TWO_PI * t;
+    camera.angleX = 0.35f + 0.25f * sin(TWO_PI * t);
+    camera.distance = 1.5f + 4.5f * (0.5f - 0.5f * cos(TWO_PI * t));
+    camera.inputCounter = 0;
+    return camera;
+}
+
+// Quote a string for JSON output
+std::string jsonString(const std::string& text) {
+    std::string quoted = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') quoted += '\\';
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+// Average, extremes and percentiles of a run's frame times
+struct FrameTimeSummary {
+    double average, min, p50, p95, p99, max;
+    
+    explicit FrameTimeSummary(const std::vector<double>& frameMs) : average(0), min(0), p50(0), p95(0), p99(0), max(0) {
+        if (frameMs.empty()) return;
+        std::vector<double> sorted = frameMs;
+        std::sort(sorted.begin(), sorted.end());
+        size_t last = sorted.size() - 1;
+        double sum = 0.0;
+        for (double ms : sorted) sum += ms;
+        average = sum / sorted.size();
+        min = sorted.front();
+        p50 = sorted[last * 50 / 100];
+        p95 = sorted[last * 95 / 100];
+        p99 = sorted[last * 99 / 100];
+        max = sorted.back();
+    }
+    
+    std::string format(const char* label = "frame ms") const {
+        char row[160];
+        snprintf(row, sizeof(row), "%s: avg %.3f  min %.3f  p50 %.3f  p95 %.3f  p99 %.3f  max %.3f", label, average, min, p50, p95, p99, max);
+        return row;
+    }
+};
+
+// Render the scripted camera path as fast as possible and report frame times and
+// throughput on stdout and as JSON for regression tracking. False if the JSON could not be written.
+bool runBenchmark(int frames, const std::string& modelPath, const std::string& jsonPath) {
+    stopRenderThread();
+    dynamicResolutionEnabled = false;
+    double ticksToMs = 1000.0 / SDL_GetPerformanceFrequency();
+    
+    // Warm caches and the texture before measuring
+    for (int i = 0; i < std::min(frames, 10); i++) {
+        applyCamera(benchmarkCamera(i, frames));
+        renderScene();
+        renderBuffer(renderer);
+    }
+    // Warm-up frames stay out of the profile
+    memset(stageTicks, 0, sizeof(stageTicks));
+    memset(stageCounters, 0, sizeof(stageCounters));
+    
+    std::vector<double> frameMs;
+    frameMs.reserve(frames);
+    size_t triangles = trianglesDrawn;
+    size_t pixels = pixelsDrawn;
+    Uint64 begin = SDL_GetPerformanceCounter();
+    for (int i = 0; i < frames; i++) {
+        Uint64 start = SDL_GetPerformanceCounter();
+        applyCamera(benchmarkCamera(i, frames));
+        renderScene();
+        renderBuffer(renderer);
+        frameMs.push_back((SDL_GetPerformanceCounter() - start) * ticksToMs);
+        finishProfiledFrame(nullptr, nullptr);
+        SDL_PumpEvents();  // Keep the window responsive without handling input
+    }
+    double seconds = (SDL_GetPerformanceCounter() - begin) * ticksToMs / 1000.0;
+    triangles = trianglesDrawn - triangles;
+    pixels = pixelsDrawn - pixels;
+    
+    FrameTimeSummary summary(frameMs);
+    
+    char row[160];
+    std::cout << "\n=== Benchmark (" << frames << " frames at " << SCREEN_WIDTH << "x" << SCREEN_HEIGHT << ", "
+              << presentStrategyName(presentStrategy) << ") ===" << std::endl;
+    std::cout << summary.format() << std::endl;
+    snprintf(row, sizeof(row), "%.1f frames/s, %.3g triangles/s, %.3g pixels/s",
+             frames / seconds, triangles / seconds, pixels / seconds);
+    std::cout << row << std::endl;
+    std::cout << "================================\n" << std::endl;
+    
+    std::ofstream json(jsonPath);
+    if (!json) {
+        std::cerr << "Could not write benchmark results to " << jsonPath << std::endl;
+        return false;
+    }
+    json << "{\n";
+    json << "  \"model\": " << jsonString(modelPath) << ",\n";
+    json << "  \"width\": " << SCREEN_WIDTH << ",\n";
+    json << "  \"height\": " << SCREEN_HEIGHT << ",\n";
+    json << "  \"frames\": " << frames << ",\n";
+    json << "  \"present\": " << jsonString(presentStrategyName(presentStrategy)) << ",\n";
+    json << "  \"monochrome\": " << (monochromeEnabled ? "true" : "false") << ",\n";
+    json << "  \"tiled\": " << (tiledEnabled ? "true" : "false") << ",\n";
+    json << "  \"dirty_rects\": " << (dirtyRectsEnabled ? "true" : "false") << ",\n";
+    snprintf(row, sizeof(row), "  \"frame_ms\": {\"avg\": %.4f, \"min\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f},\n",
+             summary.average, summary.min, summary.p50, summary.p95, summary.p99, summary.max);
+    json << row;
+    snprintf(row, sizeof(row), "  \"frames_per_second\": %.2f,\n  \"triangles_per_second\": %.0f,\n  \"pixels_per_second\": %.0f,\n",
+             frames / seconds, triangles / seconds, pixels / seconds);
+    json << row;
+    json << "  \"frame_times_ms\": [";
+    for (int i = 0; i < frames; i++) {
+        snprintf(row, sizeof(row), "%s%.4f", i ? ", " : "", frameMs[i]);
+        json << row;
+    }
+    json << "]\n}\n";
+    std::cout << "Wrote " << jsonPath << std::endl;
+    return true;
+}
+
+// Load the model once and build everything the renderer selects from: LOD chain,
+// progressive mesh, adjacency and, when asked for, the visibility cache
+bool loadScene(const std::string& modelPath, bool buildVisibility) {
+    std::vector<Vec3> vertices;
+    std::vector<Face> faces;
+    
+    if (!loadOBJ(modelPath, vertices, faces)) {
+        std::cerr << "Failed to load OBJ file" << std::endl;
+        return false;
+    }
+    
+    // Build the LOD chain once at load time
+    Uint32 lodStart = SDL_GetTicks();
+    lodChain = buildLODChain(vertices, faces);
+    std::cout << "Built " << lodChain.size() << " LOD levels in " << (SDL_GetTicks() - lodStart) << " ms" << std::endl;
+    for (size_t i = 0; i < lodChain.size(); i++) {
+        std::cout << "  Level " << i << ": " << lodChain[i].triangleCount << " triangles, error " << lodChain[i].error << std::endl;
+    }
+    
+    Uint32 pmStart = SDL_GetTicks();
+    progressiveMesh.build(vertices, faces);
+    std::cout << "Built progressive mesh with " << progressiveMesh.nodes.size() << " hierarchy nodes in "
+              << (SDL_GetTicks() - pmStart) << " ms" << std::endl;
+    
+    meshAdjacency.build(vertices, faces);
+    coherentCuller.reset(meshAdjacency);
+    std::cout << "Built adjacency with " << meshAdjacency.edges.size() << " edges ("
+              << meshAdjacency.creaseEdges.size() << " creases, " << meshAdjacency.boundaryEdges.size() << " open)" << std::endl;
+    
+    if (buildVisibility) {
+        Uint32 visStart = SDL_GetTicks();
+        const float bandDistances[] = {1.5f, 3.0f, 6.0f, 10.0f};
+        visibilityCache.build(vertices, faces, visibilitySamples, std::vector<float>(bandDistances, bandDistances + 4));
+        visibilityCacheEnabled = true;
+        std::cout << "Built visibility cache (" << visibilitySamples << " directions x 4 distances, "
+                  << visibilityCache.compressedBytes() << " bytes, "
+                  << (visibilityCache.runs.size() * ((faces.size() + 7) / 8)) << " as raw bitsets) in " << (SDL_GetTicks() - visStart) << " ms" << std::endl;
+    }
+    return true;
+}
+
+// Play a recorded session back. Recorded keys replay the setting changes and every
+// frame is drawn from its recorded camera, so animation of the original run does not
+// matter. With a window each frame is also uploaded and presented, and that cost is
+// reported apart from the total; without one frames stay in the framebuffer. Frames
+// follow each other as fast as they complete unless paced, which holds every record
+// back until its recorded time. Start with the flags it was recorded with.
+bool runReplay(const std::string& path, CameraState& view, bool paced) {
+    FILE* file = fopen(path.c_str(), "rb");
+    char magic[8];
+    int32_t size[2];
+    if (!file || fread(magic, 1, sizeof(magic), file) != sizeof(magic) || memcmp(magic, SESSION_MAGIC, sizeof(magic)) != 0 ||
+        fread(size, sizeof(int32_t), 2, file) != 2) {
+        std::cerr << "Not a recorded session: " << path << std::endl;
+        if (file) fclose(file);
+        return false;
+    }
+    autoRotate = false;
+    if (size[0] != windowWidth || size[1] != windowHeight) {
+        windowWidth = std::max(1, static_cast<int>(size[0]));
+        windowHeight = std::max(1, static_cast<int>(size[1]));
+        resizeRender();
+    }
+    
+    bool windowed = window != nullptr;
+    double ticksToMs = 1000.0 / SDL_GetPerformanceFrequency();
+    std::vector<double> frameMs, presentMs;
+    size_t presentsSkipped = 0;
+    InputResult input = {false, false, false};
+    SessionRecord record;
+    Uint32 beginTicks = SDL_GetTicks();
+    Uint64 begin = SDL_GetPerformanceCounter();
+    while (fread(&record.kind, 1, 1, file) == 1 && fread(&record.timeMs, sizeof(record.timeMs), 1, file) == 1 &&
+           fread(record.fields, sizeof(int32_t), 3, file) == 3) {
+        if (paced) {
+            Uint32 elapsed = SDL_GetTicks() - beginTicks;
+            if (record.timeMs > elapsed) SDL_Delay(record.timeMs - elapsed);
+        }
+        
+        SDL_Event event = {};
+        if (record.kind == RECORD_KEY) {
+            event.type = SDL_KEYDOWN;
+            event.key.state = SDL_PRESSED;
+            event.key.keysym.sym = record.fields[0];
+            event.key.repeat = static_cast<Uint8>(record.fields[1]);
+            handleEvent(event, view, input);
+        } else if (record.kind == RECORD_RESIZE) {
+            event.type = SDL_WINDOWEVENT;
+            event.window.event = SDL_WINDOWEVENT_SIZE_CHANGED;
+            event.window.data1 = record.fields[0];
+            event.window.data2 = record.fields[1];
+            handleEvent(event, view, input);
+        } else if (record.kind == RECORD_PRESENT && !windowed) {
+            // Recolors of an unchanged frame only touched the window
+            presentsSkipped++;
+        } else if (record.kind == RECORD_FRAME || record.kind == RECORD_PRESENT) {
+            memcpy(&view.angleX, &record.fields[0], sizeof(float));
+            memcpy(&view.angleY, &record.fields[1], sizeof(float));
+            memcpy(&view.distance, &record.fields[2], sizeof(float));
             
-            // Only draw if facing camera (you can comment this out if you want to see all faces)
-            // if (normalZ > 0) {
-                triangle(v1, v2, v3);
-                triangleCount++;
-            // }
+            Uint64 start = SDL_GetPerformanceCounter();
+            Uint64 presentStart = start;
+            if (record.kind == RECORD_PRESENT) {
+                renderBuffer(renderer);
+                finishProfiledFrame(nullptr, nullptr);
+            } else if (renderThread) {
+                // Wait for this camera's frame, not one still queued from before
+                requestFrame(view);
+                const RenderedFrame* frame = nullptr;
+                while (true) {
+                    presentStart = SDL_GetPerformanceCounter();
+                    frame = presentRenderedFrame(renderer);
+                    if (frame && frame->inputCounter >= start) break;
+                    SDL_Delay(0);
+                }
+                finishProfiledFrame(frame->stageTicks, frame->stageCounters);
+            } else {
+                applyCamera(view);
+                renderScene();
+                presentStart = SDL_GetPerformanceCounter();
+                if (windowed) renderBuffer(renderer);
+                finishProfiledFrame(nullptr, nullptr);
+            }
+            Uint64 end = SDL_GetPerformanceCounter();
+            frameMs.push_back((end - start) * ticksToMs);
+            if (windowed) presentMs.push_back((end - presentStart) * ticksToMs);
+            if (windowed && !renderThread && record.kind == RECORD_FRAME && updateRenderScale(frameMs.back())) {
+                resizeRender();
+            }
+        }
+        if (input.quit) break;
+        if (windowed) SDL_PumpEvents();
+    }
+    fclose(file);
+    double seconds = (SDL_GetPerformanceCounter() - begin) * ticksToMs / 1000.0;
+    
+    std::cout << "\n=== Replay of " << path << " (" << frameMs.size() << " frames in " << seconds << " s"
+              << (windowed ? ", presented" : ", windowless") << (paced ? ", paced" : "");
+    if (presentsSkipped) std::cout << ", " << presentsSkipped << " present-only frames skipped";
+    std::cout << ") ===" << std::endl;
+    std::cout << FrameTimeSummary(frameMs).format() << std::endl;
+    if (windowed) std::cout << FrameTimeSummary(presentMs).format("upload+present ms") << std::endl;
+    std::cout << "================================\n" << std::endl;
+    
+    // writeTrace needs every other thread idle
+    stopRenderThread();
+    if (traceEnabled) writeTrace(tracePath);
+    return true;
+}
+
+// Replay a session without a window or SDL video: the model is set up here instead
+// of after init(), and frames are only rasterized
+bool runWindowlessReplay(const std::string& path, const std::string& modelPath, bool buildVisibility, bool paced) {
+    threadedEnabled = false;
+    dynamicResolutionEnabled = false;
+    if (forceWindowSurface) presentStrategy = PRESENT_WINDOW_SURFACE;
+    initFramebuffer();
+    if (!loadScene(modelPath, buildVisibility)) return false;
+    setColor(Color(255, 255, 0));
+    CameraState view = captureCamera();
+    return runReplay(path, view, paced);
+}
+
+// Expand the single %d or %0Nd in an output pattern with the frame number.
+// False if the pattern has no such field or more than one %.
+bool frameFileName(const std::string& pattern, int frame, std::string& name) {
+    size_t percent = pattern.find('%');
+    if (percent == std::string::npos) return false;
+    size_t end = percent + 1;
+    while (end < pattern.size() && pattern[end] >= '0' && pattern[end] <= '9') end++;
+    if (end >= pattern.size() || pattern[end] != 'd' || pattern.find('%', end) != std::string::npos) return false;
+    
+    int width = std::min(atoi(pattern.substr(percent + 1, end - percent - 1).c_str()), 20);
+    bool zeroPadded = end > percent + 1 && pattern[percent + 1] == '0';
+    char number[32];
+    snprintf(number, sizeof(number), zeroPadded ? "%0*d" : "%*d", width, frame);
+    name = pattern.substr(0, percent) + number + pattern.substr(end + 1);
+    return true;
+}
+
+// Hands headless frames to an encoder thread through a small ring of image slots,
+// so rasterization only waits for the disk when every slot is still being written
+struct FrameWriter {
+    static const int SLOTS = 4;
+    std::vector<uint32_t> images[SLOTS];
+    std::string paths[SLOTS];
+    int width, height;
+    bool png;
+    SDL_atomic_t queued;    // Frames handed over so far
+    SDL_atomic_t written;   // Frames the encoder has finished with
+    SDL_atomic_t closing;   // No more frames will be queued
+    SDL_atomic_t failures;  // Files that could not be written
+    SDL_Thread* thread;
+    Uint64 stallTicks;      // Time the renderer spent waiting for a free slot
+    
+    FrameWriter() : width(0), height(0), png(false), thread(nullptr), stallTicks(0) {
+        SDL_AtomicSet(&queued, 0);
+        SDL_AtomicSet(&written, 0);
+        SDL_AtomicSet(&closing, 0);
+        SDL_AtomicSet(&failures, 0);
+    }
+    
+    static int encoderMain(void* data) {
+        FrameWriter& writer = *static_cast<FrameWriter*>(data);
+        setTraceThread("encoder");
+        while (true) {
+            // Read closing first: once it is set, queued already counts every frame
+            bool closing = SDL_AtomicGet(&writer.closing) != 0;
+            SDL_MemoryBarrierAcquire();
+            int next = SDL_AtomicGet(&writer.written);
+            if (next == SDL_AtomicGet(&writer.queued)) {
+                if (closing) break;
+                SDL_Delay(1);
+                continue;
+            }
+            // The slot's image and path were filled before queued moved past it
+            SDL_MemoryBarrierAcquire();
             
-            // If it's a quad, draw the second triangle
-            if (face.vertexIndices.size() == 4) {
-                Vec3 v4 = transformedVertices[face.vertexIndices[3][0]];
-                // if (normalZ > 0) {
-                    triangle(v1, v3, v4);
-                    triangleCount++;
-                // }
+            int slot = next % SLOTS;
+            bool saved;
+            {
+                TraceZone zone("writeFrame");
+                saved = writer.png ? writePNG(writer.paths[slot], writer.images[slot], writer.width, writer.height)
+                                   : writePPM(writer.paths[slot], writer.images[slot], writer.width, writer.height);
             }
+            if (!saved) {
+                std::cerr << "Could not write " << writer.paths[slot] << std::endl;
+                SDL_AtomicAdd(&writer.failures, 1);
+            }
+            // Finish reading the slot before the renderer may reuse it
+            SDL_MemoryBarrierRelease();
+            SDL_AtomicSet(&writer.written, next + 1);
+        }
+        return 0;
+    }
+    
+    bool start(int frameWidth, int frameHeight, bool asPNG) {
+        width = frameWidth;
+        height = frameHeight;
+        png = asPNG;
+        thread = SDL_CreateThread(encoderMain, "encoder", this);
+        return thread != nullptr;
+    }
+    
+    // Image to draw the next frame into, waiting while the encoder still holds every slot
+    std::vector<uint32_t>& acquire() {
+        int next = SDL_AtomicGet(&queued);
+        if (next - SDL_AtomicGet(&written) >= SLOTS) {
+            TraceZone zone("waitForEncoder");
+            Uint64 start = SDL_GetPerformanceCounter();
+            while (next - SDL_AtomicGet(&written) >= SLOTS) SDL_Delay(1);
+            stallTicks += SDL_GetPerformanceCounter() - start;
         }
+        SDL_MemoryBarrierAcquire();
+        return images[next % SLOTS];
+    }
+    
+    // Queue the image returned by acquire() to be written to path
+    void submit(const std::string& path) {
+        int next = SDL_AtomicGet(&queued);
+        paths[next % SLOTS] = path;
+        SDL_MemoryBarrierRelease();
+        SDL_AtomicSet(&queued, next + 1);
+    }
+    
+    // Wait until every queued frame is on disk. Returns the number of failed writes.
+    int finish() {
+        SDL_MemoryBarrierRelease();
+        SDL_AtomicSet(&closing, 1);
+        if (thread) SDL_WaitThread(thread, nullptr);
+        thread = nullptr;
+        return SDL_AtomicGet(&failures);
+    }
+};
+
+// Render the --benchmark camera path without a window or SDL video and write each
+// frame to pattern (PNG for .png names, PPM otherwise). Meant for machines without
+// a display; encoding runs on its own thread so file I/O does not pace the rasterizer.
+bool runHeadless(int frames, const std::string& pattern, const std::string& modelPath) {
+    std::string name = pattern;
+    bool numbered = pattern.find('%') != std::string::npos;
+    if ((numbered && !frameFileName(pattern, 0, name)) || (!numbered && frames > 1)) {
+        std::cerr << "Expected an output pattern with one %d or %0Nd, like frames/frame_%04d.png" << std::endl;
+        return false;
+    }
+    
+    std::vector<Vec3> vertices;
+    std::vector<Face> faces;
+    if (!loadOBJ(modelPath, vertices, faces)) return false;
+    lodChain = buildLODChain(vertices, faces);
+    
+    // Frames stay in the framebuffer and are never presented
+    threadedEnabled = false;
+    dynamicResolutionEnabled = false;
+    presentStrategy = PRESENT_PERSISTENT_TEXTURE;
+    initFramebuffer();
+    setColor(Color(255, 255, 0));
+    
+    bool png = pattern.size() >= 4 && pattern.compare(pattern.size() - 4, 4, ".png") == 0;
+    FrameWriter writer;
+    if (!writer.start(SCREEN_WIDTH, SCREEN_HEIGHT, png)) {
+        std::cerr << "Could not start the encoder thread: " << SDL_GetError() << std::endl;
+        return false;
+    }
+    
+    double ticksToMs = 1000.0 / SDL_GetPerformanceFrequency();
+    std::vector<double> frameMs;
+    frameMs.reserve(frames);
+    Uint64 begin = SDL_GetPerformanceCounter();
+    for (int i = 0; i < frames; i++) {
+        Uint64 start = SDL_GetPerformanceCounter();
+        applyCamera(benchmarkCamera(i, frames));
+        renderScene();
+        frameMs.push_back((SDL_GetPerformanceCounter() - start) * ticksToMs);
+        finishProfiledFrame(nullptr, nullptr);
+        
+        if (numbered) frameFileName(pattern, i, name);
+        captureFrame(writer.acquire());
+        writer.submit(name);
     }
+    double renderSeconds = (SDL_GetPerformanceCounter() - begin) * ticksToMs / 1000.0;
+    int failures = writer.finish();
+    double seconds = (SDL_GetPerformanceCounter() - begin) * ticksToMs / 1000.0;
+    
+    std::cout << "\n=== Headless (" << frames << " frames at " << SCREEN_WIDTH << "x" << SCREEN_HEIGHT << " to "
+              << pattern << ") ===" << std::endl;
+    std::cout << FrameTimeSummary(frameMs).format() << std::endl;
+    std::cout << "rendered in " << renderSeconds << " s, waited " << writer.stallTicks * ticksToMs
+              << " ms for the encoder, all files written after " << seconds << " s" << std::endl;
+    if (failures) std::cout << failures << " frames could not be written" << std::endl;
+    std::cout << "================================\n" << std::endl;
+    
+    if (traceEnabled) writeTrace(tracePath);
+    return failures == 0;
 }
 
 // IMPORTANT: SDL requires the main function to have these exact parameters
 int main(int argc, char* argv[]) {
+    std::string modelPath = "model.obj";
+    bool lodBenchmark = false;
+    bool buildVisibility = false;
+    bool presentBenchmark = false;
+    bool tiledBenchmark = false;
+    bool threadBenchmark = false;
+    bool inputCheck = false;
+    bool kernelBenchmark = false;
+    bool pixelBenchmark = false;
+    int benchmarkFrames = 0;
+    int kernelIterations = 100000;
+    std::string recordPath, replayPath;
+    bool replayWindow = false;
+    bool replayPaced = false;
+    int headlessFrames = 0;
+    std::string headlessPattern;
+    std::string generateKind, generatePath;
+    long long generateFaces = 0;
+    bool goldenCheck = false;
+    bool goldenUpdate = false;
+    std::string goldenDir = "golden";
+    std::string benchmarkJson = "benchmark.json";
+    
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--lod-benchmark") {
+            lodBenchmark = true;
+        } else if (arg == "--pm-budget" && i + 1 < argc) {
+            progressiveBudget = static_cast<size_t>(atol(argv[++i]));
+        } else if (arg == "--visibility-cache") {
+            buildVisibility = true;
+        } else if (arg == "--visibility-samples" && i + 1 < argc) {
+            visibilitySamples = std::max(1, atoi(argv[++i]));
+        } else if (arg == "--present-benchmark") {
+            presentBenchmark = true;
+        } else if (arg == "--present" && i + 1 < argc) {
+            std::string mode = argv[++i];
+            if (mode == "recreate") presentStrategy = PRESENT_RECREATE_TEXTURE;
+            else if (mode == "direct") presentStrategy = PRESENT_DIRECT_TO_TEXTURE;
+            else presentStrategy = PRESENT_PERSISTENT_TEXTURE;
+        } else if (arg == "--benchmark" && i + 1 < argc) {
+            benchmarkFrames = std::max(1, atoi(argv[++i]));
+        } else if (arg == "--benchmark-json" && i + 1 < argc) {
+            benchmarkJson = argv[++i];
+        } else if (arg == "--size" && i + 1 < argc) {
+            int width = 0, height = 0;
+            if (sscanf(argv[++i], "%dx%d", &width, &height) == 2 && width > 0 && height > 0) {
+                windowWidth = SCREEN_WIDTH = width;
+                windowHeight = SCREEN_HEIGHT = height;
+            } else {
+                std::cerr << "Expected --size <width>x<height>" << std::endl;
+            }
+        } else if (arg == "--input-check") {
+            inputCheck = true;
+        } else if (arg == "--fps" && i + 1 < argc) {
+            framePacer.setRate(std::max(1.0, atof(argv[++i])));
+        } else if (arg == "--dynamic-resolution") {
+            dynamicResolutionEnabled = true;
+        } else if (arg == "--frame-budget" && i + 1 < argc) {
+            frameBudgetMs = std::max(1.0f, static_cast<float>(atof(argv[++i])));
+        } else if (arg == "--hud") {
+            SDL_AtomicSet(&hudEnabled, 1);
+        } else if (arg == "--profile-csv" && i + 1 < argc) {
+            profileCsv.open(argv[++i]);
+            if (!profileCsv) {
+                std::cerr << "Could not open profile CSV " << argv[i] << std::endl;
+            }
+        } else if (arg == "--perf-counters") {
+            perfCountersEnabled = true;
+        } else if (arg == "--trace" && i + 1 < argc) {
+            traceEnabled = true;
+            tracePath = argv[++i];
+            traceStartTicks = SDL_GetPerformanceCounter();
+        } else if (arg == "--threaded") {
+            threadedEnabled = true;
+        } else if (arg == "--thread-benchmark") {
+            threadBenchmark = true;
+        } else if (arg == "--tiled") {
+            tiledEnabled = true;
+        } else if (arg == "--tiled-benchmark") {
+            tiledBenchmark = true;
+        } else if (arg == "--no-fused-clear") {
+            fusedClearEnabled = false;
+        } else if (arg == "--monochrome") {
+            monochromeEnabled = true;
+        } else if (arg == "--dirty-rects") {
+            dirtyRectsEnabled = true;
+        } else if (arg == "--software") {
+            forceWindowSurface = true;
+        } else if (arg == "--generate" && i + 3 < argc) {
+            generateKind = argv[++i];
+            generateFaces = std::max(1LL, atoll(argv[++i]));
+            generatePath = argv[++i];
+        } else if (arg == "--headless" && i + 2 < argc) {
+            headlessFrames = std::max(1, atoi(argv[++i]));
+            headlessPattern = argv[++i];
+        } else if (arg == "--record" && i + 1 < argc) {
+            recordPath = argv[++i];
+        } else if (arg == "--replay" && i + 1 < argc) {
+            replayPath = argv[++i];
+        } else if (arg == "--replay-window") {
+            replayWindow = true;
+        } else if (arg == "--replay-paced") {
+            replayPaced = true;
+        } else if (arg == "--golden-check") {
+            goldenCheck = true;
+        } else if (arg == "--golden-update") {
+            goldenUpdate = true;
+        } else if (arg == "--golden-dir" && i + 1 < argc) {
+            goldenDir = argv[++i];
+        } else if (arg == "--kernel-benchmark") {
+            kernelBenchmark = true;
+        } else if (arg == "--kernel-iterations" && i + 1 < argc) {
+            kernelIterations = std::max(1, atoi(argv[++i]));
+        } else if (arg == "--pixel-benchmark") {
+            pixelBenchmark = true;
+        } else if (arg == "--lod-threshold" && i + 1 < argc) {
+            lodPixelThreshold = static_cast<float>(atof(argv[++i]));
+        } else if (arg.compare(0, 2, "--") == 0) {
+            std::cerr << "Unknown option or missing value: " << arg << std::endl;
+            return 1;
+        } else {
+            modelPath = arg;
+        }
+    }
+    
+    // These run without a window, so they work on headless machines
+    if (!generateKind.empty()) {
+        return generateMesh(generateKind, generateFaces, generatePath, modelPath) ? 0 : 1;
+    }
+    if (kernelBenchmark) {
+        runKernelBenchmark(kernelIterations, modelPath);
+        return 0;
+    }
+    if (pixelBenchmark) {
+        runPixelBenchmark();
+        return 0;
+    }
+    if (goldenCheck || goldenUpdate) {
+        std::vector<Vec3> vertices;
+        std::vector<Face> faces;
+        if (!loadOBJ(modelPath, vertices, faces)) return 1;
+        if (goldenUpdate) return runGoldenImages(vertices, faces, goldenDir, true) ? 0 : 1;
+        bool culled = runCoherentCullingCheck(vertices, faces);
+        return runGoldenImages(vertices, faces, goldenDir, false) && culled ? 0 : 1;
+    }
+    
+    SDL_AtomicSet(&profilerEnabled, SDL_AtomicGet(&hudEnabled) || profileCsv.is_open());
+    if (perfCountersEnabled) {
+        CounterSample sample;
+        if (!readThreadCounters(sample)) {
+            std::cout << "Hardware counters are not available (Linux perf_event_open, see perf_event_paranoid)" << std::endl;
+            perfCountersEnabled = false;
+        } else {
+            std::cout << "Hardware counters:";
+            for (int c = 0; c < COUNTER_COUNT; c++) {
+                std::cout << ' ' << COUNTER_NAMES[c] << (threadCounters.position[c] < 0 ? " (unavailable)" : "");
+            }
+            std::cout << (SDL_AtomicGet(&profilerEnabled) ? "" : "; shown with --hud or --profile-csv") << std::endl;
+        }
+    }
+    if (profileCsv.is_open()) {
+        profileCsv << "frame";
+        for (int s = 0; s < STAGE_COUNT; s++) profileCsv << ',' << STAGE_NAMES[s] << "_ms";
+        profileCsv << ",total_ms";
+        if (perfCountersEnabled) {
+            for (int i = 0; i < 3; i++) {
+                for (int c = 0; c < COUNTER_COUNT; c++) profileCsv << ',' << STAGE_NAMES[COUNTED_STAGES[i]] << '_' << COUNTER_NAMES[c];
+            }
+        }
+        profileCsv << '\n';
+    }
+    if (headlessFrames > 0) {
+        return runHeadless(headlessFrames, headlessPattern, modelPath) ? 0 : 1;
+    }
+    if (!replayPath.empty() && !replayWindow) {
+        return runWindowlessReplay(replayPath, modelPath, buildVisibility, replayPaced) ? 0 : 1;
+    }
+    
     init();
     
-    if (window == nullptr || renderer == nullptr) {
+    if (window == nullptr || (renderer == nullptr && presentStrategy != PRESENT_WINDOW_SURFACE)) {
         std::cerr << "Failed to initialize SDL properly" << std::endl;
         return -1;
     }
     
-    // Print instructions
-    std::cout << "\n=== 3D OBJ Viewer Controls ===" << std::endl;
-    std::cout << "Arrow Keys: Rotate model" << std::endl;
-    std::cout << "W/S: Zoom in/out" << std::endl;
-    std::cout << "A: Toggle auto-rotation" << std::endl;
-    std::cout << "R: Reset view" << std::endl;
-    std::cout << "1-7: Change colors" << std::endl;
-    std::cout << "ESC: Quit" << std::endl;
-    std::cout << "================================\n" << std::endl;
-    
     // Load the OBJ model once
-    std::vector<Vec3> vertices;
-    std::vector<Face> faces;
+    if (!loadScene(modelPath, buildVisibility)) return -1;
     
-    if (!loadOBJ("model.obj", vertices, faces)) {
-        std::cerr << "Failed to load OBJ file" << std::endl;
-        return -1;
+    if (lodBenchmark) {
+        runLODBenchmark(lodChain);
+        SDL_Quit();
+        return 0;
     }
     
     // Set initial viewing angle (diagonal view)
@@ -447,117 +5165,82 @@ int main(int argc, char* argv[]) {
     
     // Initial render with yellow color
     setColor(Color(255, 255, 0));  // Yellow
-    render(vertices, faces);
-    renderBuffer(renderer);
     
-    bool running = true;
-    SDL_Event event;
-    Uint32 lastTime = SDL_GetTicks();
+    if (presentBenchmark) {
+        runPresentBenchmark();
+    }
+    if (tiledBenchmark) {
+        runTiledBenchmark();
+    }
+    if (threadBenchmark) {
+        runThreadBenchmark();
+    }
     
-    while (running) {
-        Uint32 currentTime = SDL_GetTicks();
-        float deltaTime = (currentTime - lastTime) / 1000.0f;
-        lastTime = currentTime;
-        
-        // Auto-rotation if enabled
-        if (autoRotate) {
-            cameraAngleY += deltaTime * 1.0f;  // Rotate 1 radian per second
-            render(vertices, faces);
-            renderBuffer(renderer);
-        }
-        
-        while (SDL_PollEvent(&event)) {
-            if (event.type == SDL_QUIT) {
-                running = false;
-            }
-            
-            if (event.type == SDL_KEYDOWN) {
-                bool needsRender = true;
-                
-                switch(event.key.keysym.sym) {
-                    // Rotation controls
-                    case SDLK_LEFT:
-                        cameraAngleY -= 0.1f;
-                        break;
-                    case SDLK_RIGHT:
-                        cameraAngleY += 0.1f;
-                        break;
-                    case SDLK_UP:
-                        cameraAngleX -= 0.1f;
-                        break;
-                    case SDLK_DOWN:
-                        cameraAngleX += 0.1f;
-                        break;
-                        
-                    // Zoom controls
-                    case SDLK_w:
-                        cameraDistance -= 0.2f;
-                        if (cameraDistance < 1.0f) cameraDistance = 1.0f;
-                        break;
-                    case SDLK_s:
-                        cameraDistance += 0.2f;
-                        if (cameraDistance > 10.0f) cameraDistance = 10.0f;
-                        break;
-                        
-                    // Auto-rotation toggle
-                    case SDLK_a:
-                        autoRotate = !autoRotate;
-                        std::cout << "Auto-rotation: " << (autoRotate ? "ON" : "OFF") << std::endl;
-                        break;
-                        
-                    // Reset view
-                    case SDLK_r:
-                        cameraAngleY = 0.785f;
-                        cameraAngleX = 0.35f;
-                        cameraDistance = 3.0f;
-                        autoRotate = false;
-                        break;
-                        
-                    // Color controls
-                    case SDLK_1:
-                        setColor(Color(255, 0, 0));  // Red
-                        break;
-                    case SDLK_2:
-                        setColor(Color(0, 255, 0));  // Green
-                        break;
-                    case SDLK_3:
-                        setColor(Color(0, 0, 255));  // Blue
-                        break;
-                    case SDLK_4:
-                        setColor(Color(255, 255, 0));  // Yellow
-                        break;
-                    case SDLK_5:
-                        setColor(Color(255, 255, 255));  // White
-                        break;
-                    case SDLK_6:
-                        setColor(Color(0, 255, 255));  // Cyan
-                        break;
-                    case SDLK_7:
-                        setColor(Color(255, 0, 255));  // Magenta
-                        break;
-                        
-                    case SDLK_ESCAPE:
-                        running = false;
-                        needsRender = false;
-                        break;
-                        
-                    default:
-                        needsRender = false;
-                        break;
-                }
-                
-                if (needsRender) {
-                    render(vertices, faces);
-                    renderBuffer(renderer);
-                }
-            }
-        }
-        
-        SDL_Delay(16);  // ~60 FPS
+    if (benchmarkFrames > 0) {
+        bool written = runBenchmark(benchmarkFrames, modelPath, benchmarkJson);
+        SDL_Quit();
+        return written ? 0 : 1;
+    }
+    
+    // The event loop edits this camera; frames are rendered from copies of it
+    CameraState view = captureCamera();
+    if (threadedEnabled && !startRenderThread()) {
+        std::cout << "Render thread needs an accelerated renderer without monochrome or tiled mode" << std::endl;
+        threadedEnabled = false;
+    }
+    
+    if (!replayPath.empty()) {
+        bool replayed = runReplay(replayPath, view, replayPaced);
+        SDL_Quit();
+        return replayed ? 0 : 1;
+    }
+    
+    // Open the session before the first frame so a replay starts from the same view
+    if (!recordPath.empty() && !sessionRecorder.open(recordPath)) {
+        std::cerr << "Could not record to " << recordPath << std::endl;
+    }
+    requestFrame(view);
+    sessionRecorder.frame(view, true);
+    
+    if (inputCheck) {
+        bool passed = runInputCoalescingCheck(view);
+        stopRenderThread();
+        SDL_Quit();
+        return passed ? 0 : 1;
+    }
+    
+    // Print instructions
+    std::cout << "\n=== 3D OBJ Viewer Controls ===" << std::endl;
+    std::cout << "Arrow Keys: Rotate model" << std::endl;
+    std::cout << "W/S: Zoom in/out" << std::endl;
+    std::cout << "A: Toggle auto-rotation" << std::endl;
+    std::cout << "R: Reset view" << std::endl;
+    std::cout << "1-7: Change colors" << std::endl;
+    std::cout << "L: Toggle level of detail" << std::endl;
+    std::cout << "P: Toggle view-dependent progressive mesh" << std::endl;
+    std::cout << "V: Toggle precomputed visible set (needs --visibility-cache)" << std::endl;
+    std::cout << "C: Toggle frame-coherent back-face culling" << std::endl;
+    std::cout << "E: Toggle silhouette and crease outline preview" << std::endl;
+    std::cout << "T: Cycle texture upload strategy" << std::endl;
+    std::cout << "D: Toggle dirty rectangle clears and uploads" << std::endl;
+    std::cout << "M: Toggle 1-bit monochrome framebuffer" << std::endl;
+    std::cout << "G: Toggle tiled framebuffer layout" << std::endl;
+    std::cout << "H: Toggle render thread" << std::endl;
+    std::cout << "F: Toggle dynamic resolution" << std::endl;
+    std::cout << "I: Toggle profiler HUD" << std::endl;
+    std::cout << "K: Write trace (needs --trace)" << std::endl;
+    std::cout << "ESC: Quit" << std::endl;
+    std::cout << "================================\n" << std::endl;
+    
+    while (runLoopIteration(view)) {
     }
     
     // Cleanup
-    SDL_DestroyRenderer(renderer);
+    stopRenderThread();
+    sessionRecorder.close();
+    if (traceEnabled) writeTrace(tracePath);
+    if (streamingTexture) SDL_DestroyTexture(streamingTexture);
+    if (renderer) SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
     SDL_Quit();
     